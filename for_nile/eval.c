@@ -11,6 +11,7 @@
 #include <sys/types.h>
 #include <errno.h>
 #include <wchar.h>
+#include <wctype.h>
 #include <locale.h>
 #include <math.h>
 #if defined(__MACH__)
@@ -19,8 +20,13 @@
 # include <ffi.h>
 #endif
 #include <assert.h>
+#if !defined(WIN32)
+# include <fcntl.h>
+# include <sys/uio.h>
+#endif
 
 extern int isatty(int);
+extern int close(int);
 
 #if defined(WIN32)
 # include <malloc.h>
@@ -43,6 +49,12 @@ extern int isatty(int);
 #include "wcs.c"
 #include "buffer.c"
 
+#if !defined(WIN32) && !(LIB_GC)
+# include <pthread.h>
+# include <setjmp.h>
+# define READ_THREADS	1	/* (read path n) reads a file with n threads */
+#endif
+
 union Object;
 
 typedef union Object *oop;
@@ -81,11 +93,11 @@ struct String	{ oop       size;  wchar_t *bits; };	/* bits is in managed memory
 struct Symbol	{ wchar_t  *bits; };
 struct Pair	{ oop 	    head, tail, source; };
 struct Array	{ oop       size, _array; };
-struct Expr	{ oop 	    name, defn, ctx, profile; };
+struct Expr	{ oop 	    name, defn, ctx, profile, calls, native; };
 struct Form	{ oop 	    function, symbol; };
 struct Fixed	{ oop       function; };
 struct Subr	{ wchar_t  *name;  imp_t imp;  proto_t *sig;  int profile; };
-struct Variable	{ oop 	    name, value, env, index, type; };
+struct Variable	{ oop 	    name, value, env, index, type, dependents; };
 struct Env	{ oop 	    parent, level, offset, bindings, stable; };
 struct Context	{ oop 	    home, env, bindings, callee, pc; };
 
@@ -159,6 +171,7 @@ static oop _newOops(int type, size_t size)	{ oop obj= GC_malloc(size);		setType(
 static char *argv0;
 
 static oop symbols= nil, globals= nil, expanders= nil, encoders= nil, evaluators= nil, applicators= nil, backtrace= nil, arguments= nil, input= nil, output= nil;
+static oop tierCompiler= nil, tierThreshold= nil, tierExpr= nil;
 static oop s_set= nil, s_define= nil, s_let= nil, s_lambda= nil, s_quote= nil, s_quasiquote= nil, s_unquote= nil, s_unquote_splicing= nil, s_t= nil, s_dot= nil, s_bracket= nil, s_brace= nil, s_main= nil;
 static oop f_set= nil, f_quote= nil, f_lambda= nil, f_let= nil, f_define;
 
@@ -317,7 +330,8 @@ static oop newExpr(oop defn, oop ctx)
   oop obj= newOops(Expr);		GC_PROTECT(obj);
   set(obj, Expr,defn,    defn);
   set(obj, Expr,ctx,     ctx);
-  set(obj, Expr,profile, newLong(0));	GC_UNPROTECT(obj);
+  set(obj, Expr,profile, newLong(0));
+  set(obj, Expr,calls,   newLong(0));	GC_UNPROTECT(obj);
   return obj;
 }
 
@@ -442,7 +456,7 @@ static int isGlobal(oop var)
 
 static oop newBool(int b)		{ return b ? s_t : nil; }
 
-static oop intern(wchar_t *string)
+static oop _intern(wchar_t *string)
 {
   ssize_t lo= 0, hi= arrayLength(symbols) - 1, c= 0;
   oop s= nil;
@@ -461,6 +475,24 @@ static oop intern(wchar_t *string)
   return s;
 }
 
+#if (READ_THREADS)
+static int		readThreads= 0;		/* workers are reading a file into their own heaps */
+static pthread_mutex_t	readSymbols= PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static oop intern(wchar_t *string)
+{
+#if (READ_THREADS)
+  if (readThreads) {
+    pthread_mutex_lock(&readSymbols);
+    oop s= _intern(string);
+    pthread_mutex_unlock(&readSymbols);
+    return s;
+  }
+#endif
+  return _intern(string);
+}
+
 #include "chartab.h"
 
 static int isPrint(int c)	{ return (0 <= c && c <= 127 && (CHAR_PRINT    & chartab[c])) || (c >= 128); }
@@ -471,9 +503,9 @@ static int isLetter(int c)	{ return (0 <= c && c <= 127 && (CHAR_LETTER   & char
 
 #define DONE	((oop)-4)	/* cannot be a tagged immediate */
 
-static oop currentPath= 0;
-static oop currentLine= 0;
-static oop currentSource= 0;
+static __thread oop currentPath= 0;
+static __thread oop currentLine= 0;
+static __thread oop currentSource= 0;
 
 static void beginSource(wchar_t *path)
 {
@@ -499,6 +531,8 @@ static void endSource(void)
 
 static oop read(FILE *fp);
 
+static __thread struct buffer readBuffer= BUFFER_INITIALISER;	/* characters of the token being read */
+
 static oop readList(FILE *fp, int delim)
 {
   oop head= nil, tail= head, obj= nil;
@@ -642,16 +676,16 @@ static oop read(FILE *fp)
 	continue;
       }
       case '"': {
-	static struct buffer buf= BUFFER_INITIALISER;
-	buffer_reset(&buf);
+	struct buffer *buf= &readBuffer;
+	buffer_reset(buf);
 	for (;;) {
 	  c= getwc(fp);
 	  if ('"' == c) break;
 	  c= readChar(c, fp);
 	  if (EOF == c)			fatal("EOF in string literal");
-	  buffer_append(&buf, c);
+	  buffer_append(buf, c);
 	}
-	oop obj= newString(buffer_contents(&buf));
+	oop obj= newString(buffer_contents(buf));
 	//buffer_free(&buf);
 	return obj;
       }
@@ -700,42 +734,42 @@ static oop read(FILE *fp)
       }
       case '0' ... '9':
       doDigits:	{
-	static struct buffer buf= BUFFER_INITIALISER;
-	buffer_reset(&buf);
+	struct buffer *buf= &readBuffer;
+	buffer_reset(buf);
 	do {
-	  buffer_append(&buf, c);
+	  buffer_append(buf, c);
 	  c= getwc(fp);
 	} while (isDigit10(c));
 	if (('.' == c) || ('e' == c)) {
 	    if ('.' == c) {
 		do {
-		    buffer_append(&buf, c);
+		    buffer_append(buf, c);
 		    c= getwc(fp);
 		} while (isDigit10(c));
 	    }
 	    if ('e' == c) {
-		buffer_append(&buf, c);
+		buffer_append(buf, c);
 		c= getwc(fp);
 		if ('-' == c) {
-		    buffer_append(&buf, c);
+		    buffer_append(buf, c);
 		    c= getwc(fp);
 		}
 		while (isDigit10(c)) {
-		    buffer_append(&buf, c);
+		    buffer_append(buf, c);
 		    c= getwc(fp);
 		}
 	    }
 	    ungetwc(c, fp);
-	    oop obj=  newDouble(wcstod(buffer_contents(&buf), 0));
+	    oop obj=  newDouble(wcstod(buffer_contents(buf), 0));
 	    return obj;
 	}
-	if (('x' == c) && (1 == buf.position))
+	if (('x' == c) && (1 == buf->position))
 	  do {
-	    buffer_append(&buf, c);
+	    buffer_append(buf, c);
 	    c= getwc(fp);
 	  } while (isDigit16(c));
 	ungetwc(c, fp);
-	oop obj= newLong(wcstoul(buffer_contents(&buf), 0, 0));
+	oop obj= newLong(wcstoul(buffer_contents(buf), 0, 0));
 	return obj;
       }
       case '(': return readList(fp, ')');      case ')': ungetwc(c, fp);  return DONE;
@@ -759,10 +793,10 @@ static oop read(FILE *fp)
       }
       default: {
 	if (isLetter(c)) {
-	  static struct buffer buf= BUFFER_INITIALISER;
+	  struct buffer *buf= &readBuffer;
 	  oop obj= nil;						GC_PROTECT(obj);
 	  //oop in= nil;					GC_PROTECT(in);
-	  buffer_reset(&buf);
+	  buffer_reset(buf);
 	  while (isLetter(c) || isDigit10(c)) {
 //	    if (('.' == c) && buf.position) {
 //	      c= getwc(fp);
@@ -776,11 +810,11 @@ static oop read(FILE *fp)
 //		buffer_reset(&buf);
 //	      }
 //	    }
-	    buffer_append(&buf, c);
+	    buffer_append(buf, c);
 	    c= getwc(fp);
 	  }
 	  ungetwc(c, fp);
-	  obj= intern(buffer_contents(&buf));
+	  obj= intern(buffer_contents(buf));
 //	  while (nil != in) {
 //	    obj= newPair(obj, nil);
 //	    obj= newPair(getHead(in), obj);
@@ -797,6 +831,235 @@ static oop read(FILE *fp)
   }
 }
 
+#if (READ_THREADS)
+
+/* Reading a file in parallel.  The file is split into chunks at the starts
+ * of lines between top-level forms, and each chunk is read by read() on a
+ * thread of its own, from a stream of its own, into a private heap.
+ * Nothing can be collected until the main thread has joined the workers
+ * and merged their heaps, so the workers need no protection from the
+ * collector.  They share the symbol table, under readSymbols, and stop at
+ * an error; the main thread then reports the error of the first chunk that
+ * had one, just as read() would have.
+ */
+
+#define READ_CHUNK	16384	/* fewest bytes worth a thread */
+
+struct readChunk
+{
+  char		*name;		/* of the file */
+  oop		 path;		/* of the file, for sources */
+  long		 offset;	/* of the start of the chunk */
+  long		 line;		/* at the start of the chunk */
+  long		 forms;		/* in the chunk, or -1 for all that remain */
+  int		 stopped;	/* read() answered DONE before the last of them */
+  GC_Heap	*heap;		/* holding the forms */
+  oop		 head, tail;	/* of the list of forms, after a dummy head */
+  char		 error[256];	/* why the chunk could not be read */
+  jmp_buf	 failed;
+  pthread_t	 thread;
+};
+
+static __thread struct readChunk *readChunk= 0;	/* being read by this thread */
+
+static void *readForms(void *arg)
+{
+  struct readChunk *k= arg;
+  FILE		   *stream= fopen(k->name, "r");
+  long		    n;
+  GC_use_heap(k->heap);
+  readChunk= k;
+  if (!setjmp(k->failed)) {
+    if (!stream || fseek(stream, k->offset, SEEK_SET)) fatal("read: %s: %s", k->name, strerror(errno));
+    fwide(stream, 1);
+    currentPath= k->path;
+    currentLine= newLong(k->line);
+    currentSource= newPair(nil, nil);
+    set(currentSource, Pair,source, newPair(currentPath, currentLine));
+    k->head= k->tail= newPairFrom(nil, nil, currentSource);
+    for (n= 0;  k->forms < 0 || n < k->forms;  ++n) {
+      oop obj= read(stream);
+      if (obj == DONE) {
+	k->stopped= 1;
+	break;
+      }
+      k->tail= setTail(k->tail, newPairFrom(obj, nil, currentSource));
+    }
+  }
+  if (stream) fclose(stream);
+  free(readBuffer.buffer);
+  return 0;
+}
+
+/* Split size bytes into at most n chunks of at least READ_CHUNK bytes,
+ * each beginning at the start of a line between top-level forms.  The scan
+ * follows read() far enough to know where the strings, comments, character
+ * literals, numbers, symbols and lists are, so that it can count the forms
+ * in each chunk and the line endings before it just as read() does.
+ * Answers the number of chunks. */
+
+static int readSplit(struct readChunk *chunks, int n, unsigned char *bytes, size_t size)
+{
+  size_t quantum= size / n, start= 0, i= 0;
+  long	 line= 1, forms= 0;
+  int	 count= 0, depth= 0, prefix= 0, symbol= 0;
+  if (quantum < READ_CHUNK) quantum= READ_CHUNK;
+  chunks[0].line= 1;
+  while (i < size && count < n - 1) {
+    int c= bytes[i++];
+    if (symbol && (isLetter(c) || isDigit10(c))) continue;
+    symbol= 0;
+    switch (c) {
+      case '\n':
+	while (i < size && '\r' == bytes[i]) ++i;
+	goto newline;
+      case '\r':
+	while (i < size && '\n' == bytes[i]) ++i;
+      newline:
+	++line;
+	if (!depth && !prefix && i - start >= quantum && i < size) {
+	  chunks[count++].forms= forms;
+	  chunks[count].offset= start= i;
+	  chunks[count].line= line;
+	  forms= 0;
+	}
+	continue;
+      case '\t':  case ' ':
+	continue;
+      case ';':
+	while (i < size && '\n' != bytes[i] && '\r' != bytes[i]) ++i;
+	continue;
+      case '\'':  case '`':
+	prefix= 1;
+	continue;
+      case ',':
+	if (i < size && '@' == bytes[i]) ++i;
+	prefix= 1;
+	continue;
+      case ')':  case ']':  case '}':
+	if (!depth) goto done;		/* read() stops here */
+	--depth;
+	continue;
+    }
+    /* c begins a datum */
+    if (!depth) ++forms;
+    prefix= 0;
+    switch (c) {
+      case '"':
+	while (i < size && '"' != bytes[i])
+	  if ('\\' == bytes[i++] && i < size) ++i;
+	if (i < size) ++i;
+	break;
+      case '?': {			/* as readChar() */
+	int e= (i < size) ? bytes[i++] : 0, m;
+	if ('\\' == e) {
+	  e= (i < size) ? bytes[i++] : 0;
+	  if ('u' == e)
+	    i= (i + 4 < size) ? i + 4 : size;
+	  else if ('x' == e)
+	    for (m= 2;  m-- && i < size && isHexadecimal(bytes[i]);  ++i);
+	  else if (isOctal(e))
+	    for (m= 2;  m-- && i < size && isOctal(bytes[i]);  ++i);
+	}
+	while (i < size && 0x80 == (bytes[i] & 0xc0)) ++i;
+	break;
+      }
+      case '(':  case '[':  case '{':
+	++depth;
+	break;
+      case '-':
+	if (i < size && isDigit10(bytes[i])) goto number;
+	symbol= 1;
+	break;
+      case '0' ... '9':
+      number: {
+	size_t begin= i - 1;
+	while (i < size && isDigit10(bytes[i])) ++i;
+	if (i < size && ('.' == bytes[i] || 'e' == bytes[i])) {
+	  if ('.' == bytes[i])
+	    do ++i; while (i < size && isDigit10(bytes[i]));
+	  if (i < size && 'e' == bytes[i]) {
+	    if (++i < size && '-' == bytes[i]) ++i;
+	    while (i < size && isDigit10(bytes[i])) ++i;
+	  }
+	}
+	else if (i < size && 'x' == bytes[i] && 1 == i - begin)
+	  do ++i; while (i < size && isDigit16(bytes[i]));
+	break;
+      }
+      default:
+	symbol= 1;
+	break;
+    }
+  }
+ done:
+  chunks[count].forms= -1;
+  return count + 1;
+}
+
+/* Answer the list of the forms in the file at path, read with at most n
+ * threads. */
+
+static oop readParallel(wchar_t *path, long n)
+{
+  char		   *name= strdup(wcs2mbs(path));
+  FILE		   *stream= fopen(name, "r");
+  struct readChunk *chunks;
+  unsigned char	   *bytes= 0;
+  size_t	    size= 0, max= 0, count;
+  oop		    head= nil;
+  int		    i, status;
+  if (!stream) {
+    free(name);
+    return nil;
+  }
+  do {
+    if (size == max) bytes= realloc(bytes, max= max ? max * 2 : READ_CHUNK);
+    size += (count= fread(bytes + size, 1, max - size, stream));
+  } while (count);
+  fclose(stream);
+  if (n > size / READ_CHUNK + 1) n= size / READ_CHUNK + 1;
+  chunks= calloc(n, sizeof(struct readChunk));
+  n= readSplit(chunks, n, bytes, size);
+  free(bytes);
+  readThreads= 1;
+  for (i= 0;  i < n;  ++i) {
+    chunks[i].name= name;
+    chunks[i].path= currentPath;
+    chunks[i].heap= GC_new_heap();
+    if ((status= pthread_create(&chunks[i].thread, 0, readForms, chunks + i)))
+      fatal("read: %s", strerror(status));
+  }
+  for (i= 0;  i < n;  ++i)
+    pthread_join(chunks[i].thread, 0);
+  readThreads= 0;
+  for (i= 0;  i < n;  ++i)
+    GC_merge_heap(chunks[i].heap);
+  free(name);
+  for (i= 0;  i < n;  ++i) {
+    if (chunks[i].error[0]) fatal("%s", chunks[i].error);
+    if (chunks[i].stopped)  n= i + 1;	/* as would read() */
+  }
+  for (i= n;  i--;  ) {
+    setTail(chunks[i].tail, head);
+    head= getTail(chunks[i].head);
+  }
+  free(chunks);
+  return head;
+}
+
+#endif
+
+/* stdout and string output streams are byte oriented: write wide
+ * characters to them as multibyte sequences rather than with putwc */
+
+static wint_t putwch(wint_t c, FILE *stream)
+{
+  if (fwide(stream, 0) > 0) return putwc(c, stream);
+  if (c < 0x80) return (EOF == putc(c, stream)) ? WEOF : c;
+  return (fprintf(stream, "%lc", c) < 0) ? WEOF : c;
+}
+
 static void doprint(FILE *stream, oop obj, int storing)
 {
   if (!obj) {
@@ -828,9 +1091,9 @@ static void doprint(FILE *stream, oop obj, int storing)
 	while ((c= *p++)) {
 	  if (c >= ' ')
 	    switch (c) {
-	      case '"':  printf("\\\"");  break;
-	      case '\\': printf("\\\\");  break;
-	      default:	 putwc(c, stream);  break;
+	      case '"':  fprintf(stream, "\\\"");  break;
+	      case '\\': fprintf(stream, "\\\\");  break;
+	      default:	 putwch(c, stream);  break;
 	    }
 	  else fprintf(stream, "\\%03o", c);
 	}
@@ -967,16 +1230,18 @@ static void doprint(FILE *stream, oop obj, int storing)
   }
 }
 
-static void print(oop obj)			{ doprint(stdout, obj, 0);  fflush(stdout); }
+/* printing does not flush: output streams are flushed explicitly (flush
+ * subr), before reading from the console, on fatal errors and at exit */
+
+static void fprint(FILE *stream, oop obj)	{ doprint(stream, obj, 0); }
 
-static void fdump(FILE *stream, oop obj)	{ doprint(stream, obj, 1);  fflush(stream); }
+static void fdump(FILE *stream, oop obj)	{ doprint(stream, obj, 1); }
 static void dump(oop obj)			{ fdump(stdout, obj); }
 
 static void fdumpln(FILE *stream, oop obj)
 {
   fdump(stream, obj);
   fprintf(stream, "\n");
-  fflush(stream);
 }
 
 static void dumpln(oop obj)			{ fdumpln(stdout, obj); }
@@ -1217,6 +1482,16 @@ static int printSource(oop exp)
 
 static void fatal(char *reason, ...)
 {
+#if (READ_THREADS)
+  if (readChunk) {		/* a worker: the main thread reports the error */
+    va_list ap;
+    va_start(ap, reason);
+    vsnprintf(readChunk->error, sizeof(readChunk->error), reason ? reason : "read failed", ap);
+    va_end(ap);
+    longjmp(readChunk->failed, 1);
+  }
+#endif
+  fflush(0);
   if (reason) {
     va_list ap;
     va_start(ap, reason);
@@ -1315,11 +1590,67 @@ static oop evlist(oop obj, oop ctx)
 
 static oop ffcall(oop subr, oop arguments);
 
+/* While *tier-compiler* is set each Expr counts its calls, and the
+ * iterations of its loops, in calls.  When calls reaches *tier-threshold*
+ * the compiler is applied to the Expr.  It answers a Subr running the Expr
+ * natively, which apply then prefers for Long arguments, or nil, after which
+ * calls is nil and the Expr stays interpreted.  A compiler adds the Expr to
+ * the dependents of each global its code relies on; setting that global
+ * sends the Expr back to the interpreter to be counted again.
+ */
+
+static int tiering= 0;		/* the compiler is running */
+
+static void tierCount(oop expr)
+{
+  oop calls= get(expr, Expr,calls);
+  if (isLong(calls)) set(expr, Expr,calls, newLong(getLong(calls) + 1));
+}
+
+static oop promote(oop fun, oop ctx)
+{
+  tierCount(fun);
+  oop calls=     get(fun, Expr,calls);
+  oop threshold= get(tierThreshold, Variable,value);
+  if (tiering || !isLong(calls) || !isLong(threshold) || getLong(calls) < getLong(threshold)) return nil;
+  oop native= nil;				GC_PROTECT(fun);
+  tiering= 1;
+  native= apply(get(tierCompiler, Variable,value), newPair(fun, nil), ctx);
+  tiering= 0;
+  if (!is(Subr, native)) native= nil;
+  set(fun, Expr,native, native);
+  set(fun, Expr,calls,  (nil == native) ? nil : newLong(0));	GC_UNPROTECT(fun);
+  return native;
+}
+
+static void deoptimise(oop var)
+{
+  oop exprs= get(var, Variable,dependents);
+  set(var, Variable,dependents, nil);
+  while (is(Pair, exprs)) {
+    set(getHead(exprs), Expr,native, nil);
+    set(getHead(exprs), Expr,calls,  newLong(0));
+    exprs= getTail(exprs);
+  }
+}
+
+static int isLongs(oop list)
+{
+  while (is(Pair, list)) {
+    if (!isLong(getHead(list))) return 0;
+    list= getTail(list);
+  }
+  return 1;
+}
+
 static oop apply(oop fun, oop arguments, oop ctx)
 {
   if (opt_v > 2) { printf("APPLY ");  dump(fun);  printf(" TO ");  dump(arguments);  printf(" IN ");  dumpln(ctx); }
   switch (getType(fun)) {
     case Expr: {
+      oop native= get(fun, Expr,native);
+      if (nil == native && nil != get(tierCompiler, Variable,value)) native= promote(fun, ctx);
+      if (nil != native && isLongs(arguments)) return apply(native, arguments, ctx);
       if (opt_p) arrayAtPut(traceStack, traceDepth++, fun);
       oop args=    arguments;
       oop defn=    get(fun, Expr,defn);				GC_PROTECT(defn);
@@ -1353,6 +1684,8 @@ static oop apply(oop fun, oop arguments, oop ctx)
       }
       oop ans= nil;
       oop body= cddr(defn);
+      oop caller= tierExpr;
+      tierExpr= fun;
       if (opt_g) arrayAtPut(traceStack, traceDepth++, body);
       while (is(Pair, body)) {
 	if (opt_g) arrayAtPut(traceStack, traceDepth - 1, getHead(body));
@@ -1360,6 +1693,7 @@ static oop apply(oop fun, oop arguments, oop ctx)
 	ans= eval(getHead(body), ctx);
 	body= getTail(body);
       }
+      tierExpr= caller;
       if (opt_g || opt_p) --traceDepth;
       //GC_UNPROTECT(tmp);
       GC_UNPROTECT(ctx);
@@ -1569,7 +1903,10 @@ static subr(set)
   }
   oop val= eval(cadr(args), ctx);
   if (is(Expr, val) && (nil == get(val, Expr,name))) set(val, Expr,name, get(var, Variable,name));
-  if (isGlobal(var)) return set(var, Variable,value, val);
+  if (isGlobal(var)) {
+    if (nil != get(var, Variable,dependents)) deoptimise(var);
+    return set(var, Variable,value, val);
+  }
   int delta= getLong(get(get(ctx, Context,env), Env,level)) - getLong(get(get(var, Variable,env), Env,level));
   oop cx= ctx;
   while (delta--) cx= get(cx, Context,home);
@@ -1608,6 +1945,7 @@ static subr(while)
 {
   oop tst= car(args);
   while (nil != eval(tst, ctx)) {
+    if (nil != tierExpr && nil != get(tierCompiler, Variable,value)) tierCount(tierExpr);
     oop body= cdr(args);
     while (is(Pair, body)) {
       eval(getHead(body), ctx);
@@ -1636,6 +1974,7 @@ static subr(define)
     fatal(0);
   }
   oop value= eval(cadr(args), ctx);
+  if (nil != get(var, Variable,dependents)) deoptimise(var);
   set(var, Variable,value, value);
   oop expr= value;
   if (is(Form, expr)) expr= get(value, Form,function);
@@ -1874,11 +2213,103 @@ static subr(open)
   return stream ? newLong((long)stream) : nil;
 }
 
+typedef struct strout
+{
+  FILE		*stream;
+  char		*bits;
+  size_t	 size;
+  struct strout	*next;
+} strout_t;
+
+static strout_t *strouts= 0;
+
+static strout_t *findStrout(FILE *stream)
+{
+  strout_t *s;
+  for (s= strouts;  s;  s= s->next)
+    if (stream == s->stream) return s;
+  return 0;
+}
+
+static subr(open_output_string)
+{
+  strout_t *s= calloc(1, sizeof(strout_t));
+  if (!s || !(s->stream= open_memstream(&s->bits, &s->size))) {
+    free(s);
+    return nil;
+  }
+  fwide(s->stream, -1);
+  s->next= strouts;
+  strouts= s;
+  return newLong((long)s->stream);
+}
+
+static subr(get_output_string)
+{
+  oop arg= car(args);
+  if (nil == arg) arg= get(output, Variable,value);
+  if (!isLong(arg)) { fprintf(stderr, "get-output-string: non-integer argument: ");  fdumpln(stderr, arg);  fatal(0); }
+  strout_t *s= findStrout((FILE *)getLong(arg));
+  if (!s) { fprintf(stderr, "get-output-string: not a string output stream: ");  fdumpln(stderr, arg);  fatal(0); }
+  fflush(s->stream);
+  return newString(mbs2wcs(s->bits));
+}
+
 static subr(close)
 {
   oop arg= car(args);
   if (!isLong(arg)) { fprintf(stderr, "close: non-integer argument: ");  fdumpln(stderr, arg);  fatal(0); }
-  fclose((FILE *)getLong(arg));
+  FILE *stream= (FILE *)getLong(arg);
+  fclose(stream);
+  strout_t **sp;
+  for (sp= &strouts;  *sp;  sp= &(*sp)->next)
+    if (stream == (*sp)->stream) {
+      strout_t *s= *sp;
+      *sp= s->next;
+      free(s->bits);
+      free(s);
+      break;
+    }
+  return arg;
+}
+
+/* Answer the address of the bytes in buf selected by the optional
+ * offset and count at the front of args, defaulting to everything from
+ * offset to the end.  Used by the subrs that move bytes in bulk.
+ */
+
+static char *dataSpan(oop buf, long off, long num, char *who)
+{
+  if (!is(Data, buf)) { fprintf(stderr, "%s: non-Data argument: ", who);  fdumpln(stderr, buf);  fatal(0); }
+  long size= GC_size(buf);
+  if (off < 0 || off > size)		fatal("%s: offset %ld out of bounds for Data of length %ld", who, off, size);
+  if (num < 0 || num > size - off)	fatal("%s: count %ld out of bounds for Data of length %ld at offset %ld", who, num, size, off);
+  return (char *)buf + off;
+}
+
+static char *dataRange(oop buf, oop args, size_t *count, char *who)
+{
+  long off= 0, num= -1;
+  if (is(Pair, args)) {
+    oop arg= getHead(args);		if (!isLong(arg)) { fprintf(stderr, "%s: non-integer offset: ", who);  fdumpln(stderr, arg);  fatal(0); }
+    off= getLong(arg);
+    args= getTail(args);
+  }
+  if (is(Pair, args)) {
+    oop arg= getHead(args);		if (!isLong(arg)) { fprintf(stderr, "%s: non-integer count: ", who);  fdumpln(stderr, arg);  fatal(0); }
+    num= getLong(arg);
+  }
+  if (num < 0 && is(Data, buf) && off >= 0 && off <= GC_size(buf)) num= GC_size(buf) - off;
+  *count= num;
+  return dataSpan(buf, off, num, who);
+}
+
+static subr(flush)
+{
+  oop arg= car(args);
+  if (nil == arg) arg= get(output, Variable,value);
+  if (!isLong(arg)) { fprintf(stderr, "flush: non-integer argument: ");  fdumpln(stderr, arg);  fatal(0); }
+  fflush((FILE *)getLong(arg));
   return arg;
 }
 
@@ -1922,15 +2353,44 @@ static subr(putc)
   if (!isLong(chr)) { fprintf(stderr, "putc: non-integer character: ");  fdumpln(stderr, chr);  fatal(0); }
   if (!isLong(arg)) { fprintf(stderr, "putc: non-integer argument: ");  fdumpln(stderr, arg);  fatal(0); }
   FILE *stream= (FILE *)getLong(arg);
-  int c= putwc(getLong(chr), stream);
+  int c= putwch(getLong(chr), stream);
   return (WEOF == c) ? nil : chr;
 }
 
+/* Bulk transfer between a byte-oriented stream (opened with a negative
+ * width) and Data: (read-bytes stream data [offset [count]]) answers the
+ * number of bytes read or nil at end of file, write-bytes the number written.
+ */
+
+static subr(read_bytes)
+{
+  oop arg= car(args);
+  if (nil == arg) arg= get(input, Variable,value);
+  if (!isLong(arg)) { fprintf(stderr, "read-bytes: non-integer argument: ");  fdumpln(stderr, arg);  fatal(0); }
+  FILE  *stream= (FILE *)getLong(arg);
+  size_t count;
+  char  *addr= dataRange(cadr(args), cddr(args), &count, "read-bytes");
+  size_t n= fread(addr, 1, count, stream);
+  return (0 == n && count) ? nil : newLong(n);
+}
+
+static subr(write_bytes)
+{
+  oop arg= car(args);
+  if (nil == arg) arg= get(output, Variable,value);
+  if (!isLong(arg)) { fprintf(stderr, "write-bytes: non-integer argument: ");  fdumpln(stderr, arg);  fatal(0); }
+  FILE  *stream= (FILE *)getLong(arg);
+  size_t count;
+  char  *addr= dataRange(cadr(args), cddr(args), &count, "write-bytes");
+  return newLong(fwrite(addr, 1, count, stream));
+}
+
 static subr(read)
 {
   FILE *stream= stdin;
   oop   head= nil;
   if (nil == args) {
+    fflush(stdout);
     beginSource(L"<stdin>");
     oop obj= read(stdin);
     endSource();
@@ -1942,6 +2402,15 @@ static subr(read)
       wchar_t *path= get(arg, String,bits);
       stream= fopen(wcs2mbs(path), "r");
       if (!stream) return nil;
+#if (READ_THREADS)
+      if (isLong(cadr(args)) && getLong(cadr(args)) > 1) {
+	fclose(stream);
+	beginSource(path);
+	head= readParallel(path, getLong(cadr(args)));
+	endSource();
+	return head;
+      }
+#endif
       fwide(stream, 1);
       beginSource(path);
       head= newPairFrom(nil, nil, currentSource);		GC_PROTECT(head);
@@ -2020,6 +2489,7 @@ static subr(type_of)
 
 static subr(warn)
 {
+  fflush(stdout);
   while (is(Pair, args)) {
     doprint(stderr, getHead(args), 0);
     args= getTail(args);
@@ -2027,10 +2497,17 @@ static subr(warn)
   return nil;
 }
 
+static FILE *outputStream(void)
+{
+  oop stream= get(output, Variable,value);
+  return isLong(stream) ? (FILE *)getLong(stream) : stdout;
+}
+
 static subr(print)
 {
+  FILE *stream= outputStream();
   while (is(Pair, args)) {
-    print(getHead(args));
+    fprint(stream, getHead(args));
     args= getTail(args);
   }
   return nil;
@@ -2038,50 +2515,137 @@ static subr(print)
 
 static subr(dump)
 {
+  FILE *stream= outputStream();
   while (is(Pair, args)) {
-    dump(getHead(args));
+    fdump(stream, getHead(args));
     args= getTail(args);
   }
   return nil;
 }
 
-static subr(format)
-{
-  arity2(args, "format");
-  oop     ofmt= car(args);		if (!is(String, ofmt)) fatal("format is not a string");
-  oop     oarg= cadr(args);
-  wchar_t *fmt= get(ofmt, String,bits);
-  int     farg= 0;
-  union { long l;  void *p;  double d; } arg;
-  switch (getType(oarg)) {
-      case Undefined:					  break;
-      case Long:	arg.l= getLong(oarg);		  break;
-      case Double:	arg.d= getDouble(oarg);  ++farg;  break;
-      case String:	arg.p= get(oarg, String,bits);	  break;
-      case Symbol:	arg.p= get(oarg, Symbol,bits);	  break;
-      default:		arg.p= oarg;			  break;
-  }
-  size_t size= 100;
-  wchar_t *p, *np;
-  oop ans= nil;
-  if (!(p= malloc(sizeof(wchar_t) * size))) return nil;
-  for (;;) {
-      int n= farg ? swnprintf(p, size, fmt, arg.d) : swnprintf(p, size, fmt, arg);
-    if (0 <= n && n < size) {
-      ans= newString(p);
-      free(p);
-      break;
+/* format a list of arguments according to the printf-style directives in
+ * fmt, appending the result to buf.  integer directives take Longs (and
+ * are always formatted as longs), floating-point directives take Doubles
+ * or Longs, %s and %ls print Strings and Symbols as they are and any other
+ * object as print would, and * widths and precisions are taken from the
+ * argument list. */
+
+static void formatArgs(struct buffer *buf, wchar_t *fmt, oop args, char *who)
+{
+  while (*fmt) {
+    if ('%' != *fmt)   { buffer_append(buf, *fmt++);  continue; }
+    if ('%' == fmt[1]) { buffer_append(buf, '%');  fmt += 2;  continue; }
+    wchar_t spec[64];
+    int     n= 0, width= 0, prec= -1, left= 0;
+    spec[n++]= *fmt++;
+    while (*fmt && wcschr(L"-+ #0", *fmt)) {
+      if ('-' == *fmt) left= 1;
+      if (n < 8) spec[n++]= *fmt;
+      ++fmt;
     }
-    if (n < 0 && errno == EILSEQ) return nil;
-    if (n >= 0)	size= n + 1;
-    else	size *= 2;
-    if (!(np= realloc(p, sizeof(wchar_t) * size))) {
-      free(p);
-      break;
+    if ('*' == *fmt) {
+      oop arg= car(args);  args= cdr(args);
+      if (!isLong(arg)) { fprintf(stderr, "%s: non-integer width: ", who);  fdumpln(stderr, arg);  fatal(0); }
+      ++fmt;
+      if ((width= getLong(arg)) < 0) width= -width, left= 1, spec[n++]= '-';
+    }
+    else
+      while (iswdigit(*fmt)) width= width * 10 + *fmt++ - '0';
+    if ('.' == *fmt) {
+      ++fmt;
+      if ('*' == *fmt) {
+	oop arg= car(args);  args= cdr(args);
+	if (!isLong(arg)) { fprintf(stderr, "%s: non-integer precision: ", who);  fdumpln(stderr, arg);  fatal(0); }
+	++fmt;
+	prec= getLong(arg);
+      }
+      else
+	for (prec= 0;  iswdigit(*fmt);  ++fmt) prec= prec * 10 + *fmt - '0';
+    }
+    while (*fmt && wcschr(L"hlLqjzt", *fmt)) ++fmt;
+    int conv= *fmt++;
+    if (!conv) fatal("%s: incomplete directive at end of format", who);
+    if (!is(Pair, args)) fatal("%s: too few arguments", who);
+    oop arg= getHead(args);  args= getTail(args);
+    if ('s' == conv) {
+      wchar_t *str= 0;
+      if      (is(String, arg)) str= get(arg, String,bits);
+      else if (is(Symbol, arg)) str= get(arg, Symbol,bits);
+      else {
+	char   *bits= 0;
+	size_t  size= 0;
+	FILE   *stream= open_memstream(&bits, &size);
+	if (!stream) fatal("%s: cannot print argument for %%s", who);
+	fwide(stream, -1);
+	fprint(stream, arg);
+	fclose(stream);
+	str= mbs2wcs(bits);
+	free(bits);
+      }
+      int len= wcslen(str), pad;
+      if (prec >= 0 && prec < len) len= prec;
+      if (!left) for (pad= len;  pad < width;  ++pad) buffer_append(buf, ' ');
+      for (n= 0;  n < len;  ++n) buffer_append(buf, str[n]);
+      if (left)  for (pad= len;  pad < width;  ++pad) buffer_append(buf, ' ');
+      continue;
     }
-    p= np;
+    if (width)     n += swprintf(spec + n, 64 - n, L"%d", width);
+    if (prec >= 0) n += swprintf(spec + n, 64 - n, L".%d", prec);
+    size_t   size= 400 + width + (prec > 0 ? prec : 0);	/* %f of DBL_MAX is 316 characters */
+    wchar_t  local[512];
+    wchar_t *out= (size <= 512) ? local : malloc(sizeof(wchar_t) * size);
+    int      len= 0;
+    switch (conv) {
+      case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+	if (!isLong(arg)) { fprintf(stderr, "%s: non-integer argument for %%%lc: ", who, conv);  fdumpln(stderr, arg);  fatal(0); }
+	spec[n++]= 'l';  spec[n++]= conv;  spec[n]= 0;
+	len= swprintf(out, size, spec, getLong(arg));
+	break;
+      case 'c':
+	if (!isLong(arg)) { fprintf(stderr, "%s: non-integer argument for %%c: ", who);  fdumpln(stderr, arg);  fatal(0); }
+	spec[n++]= 'l';  spec[n++]= 'c';  spec[n]= 0;
+	len= swprintf(out, size, spec, (wint_t)getLong(arg));
+	break;
+      case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A': {
+	double d= 0;
+	if      (isDouble(arg)) d= getDouble(arg);
+	else if (isLong(arg))   d= getLong(arg);
+	else { fprintf(stderr, "%s: non-numeric argument for %%%lc: ", who, conv);  fdumpln(stderr, arg);  fatal(0); }
+	spec[n++]= conv;  spec[n]= 0;
+	len= swprintf(out, size, spec, d);
+	break;
+      }
+      case 'p':
+	spec[n++]= 'p';  spec[n]= 0;
+	len= swprintf(out, size, spec, isLong(arg) ? (void *)getLong(arg) : (void *)arg);
+	break;
+      default:
+	fatal("%s: unknown directive '%%%lc'", who, conv);
+    }
+    if (len < 0) fatal("%s: cannot format '%ls'", who, spec);
+    int i;
+    for (i= 0;  i < len;  ++i) buffer_append(buf, out[i]);
+    if (out != local) free(out);
   }
-  return ans;
+}
+
+static subr(format)
+{
+  static struct buffer buf= BUFFER_INITIALISER;
+  oop     ofmt= car(args);		if (!is(String, ofmt)) fatal("format is not a string");
+  buffer_reset(&buf);
+  formatArgs(&buf, get(ofmt, String,bits), cdr(args), "format");
+  return newString(buffer_contents(&buf));
+}
+
+static subr(printf)
+{
+  static struct buffer buf= BUFFER_INITIALISER;
+  oop     ofmt= car(args);		if (!is(String, ofmt)) fatal("printf: format is not a string");
+  buffer_reset(&buf);
+  formatArgs(&buf, get(ofmt, String,bits), cdr(args), "printf");
+  fprintf(outputStream(), "%ls", buffer_contents(&buf));
+  return newLong(buf.position);
 }
 
 static subr(form)
@@ -2217,6 +2781,150 @@ static subr(string_copy)	// string from len
   return newStringN(get(str, String,bits) + ifr, sln);
 }
 
+/* a String doubles as a string builder: string-append grows it in place,
+ * keeping spare capacity at the end of its bits (as arrays do for their
+ * elements) so that appending is amortised O(1) and the finished string
+ * needs no further copying. */
+
+static wchar_t *stringBits(oop obj)
+{
+  if (is(String, obj)) return get(obj, String,bits);
+  if (is(Symbol, obj)) return get(obj, Symbol,bits);
+  return 0;
+}
+
+static int stringBitsLength(oop obj)
+{
+  return is(String, obj) ? stringLength(obj) : wcslen(get(obj, Symbol,bits));
+}
+
+static oop stringAppend(oop str, wchar_t *chars, int n)
+{
+  int      len=  stringLength(str);
+  wchar_t *bits= get(str, String,bits);
+  int      cap=  GC_size(bits) / sizeof(wchar_t) - 1;
+  if (len + n > cap) {
+    if (cap < 8) cap= 8;
+    while (cap < len + n) cap *= 2;
+    GC_PROTECT(str);
+    wchar_t *gstr= (wchar_t *)_newBits(-1, sizeof(wchar_t) * (cap + 1));
+    GC_UNPROTECT(str);
+    wmemcpy(gstr, bits, len);
+    set(str, String,bits, bits= gstr);
+  }
+  wmemcpy(bits + len, chars, n);
+  bits[len + n]= 0;
+  set(str, String,size, newLong(len + n));
+  return str;
+}
+
+static subr(string_append)
+{
+  oop str= car(args);			if (!is(String, str)) { fprintf(stderr, "string-append: non-string argument: ");  fdumpln(stderr, str);  fatal(0); }
+  for (args= getTail(args);  is(Pair, args);  args= getTail(args)) {
+    oop arg= getHead(args);
+    if (isLong(arg)) {
+      wchar_t c= getLong(arg);
+      stringAppend(str, &c, 1);
+    }
+    else {
+      wchar_t *bits= stringBits(arg);	if (!bits) { fprintf(stderr, "string-append: non-character/string argument: ");  fdumpln(stderr, arg);  fatal(0); }
+      stringAppend(str, bits, stringBitsLength(arg));
+    }
+  }
+  return str;
+}
+
+static oop concatStringsN(oop args, int n, char *who)
+{
+  int len= 0, i;
+  oop arg= args;
+  for (i= 0;  i < n;  ++i, arg= getTail(arg)) {
+    if (!stringBits(getHead(arg))) { fprintf(stderr, "%s: non-string argument: ", who);  fdumpln(stderr, getHead(arg));  fatal(0); }
+    len += stringBitsLength(getHead(arg));
+  }
+  oop      str=  _newString(len);
+  wchar_t *bits= get(str, String,bits);
+  for (i= 0;  i < n;  ++i, args= getTail(args)) {
+    int l= stringBitsLength(getHead(args));
+    wmemcpy(bits, stringBits(getHead(args)), l);
+    bits += l;
+  }
+  return str;
+}
+
+static subr(concat_string)
+{
+  arity2(args, "concat-string");
+  return concatStringsN(args, 2, "concat-string");
+}
+
+static subr(concat_strings)
+{
+  int n= 1;
+  oop arg= cdr(args);
+  while (is(String, car(arg))) ++n, arg= cdr(arg);
+  if (n == 1) return car(args);
+  return concatStringsN(args, n, "concat-strings");
+}
+
+static subr(concat_symbol)
+{
+  arity2(args, "concat-symbol");
+  static struct buffer buf= BUFFER_INITIALISER;
+  buffer_reset(&buf);
+  while (is(Pair, args)) {
+    wchar_t *bits= stringBits(getHead(args));	if (!bits) { fprintf(stderr, "concat-symbol: non-symbol argument: ");  fdumpln(stderr, getHead(args));  fatal(0); }
+    buffer_appendAll(&buf, bits);
+    args= getTail(args);
+  }
+  return intern(buffer_contents(&buf));
+}
+
+static subr(concat_symbols)
+{
+  static struct buffer buf= BUFFER_INITIALISER;
+  oop result= car(args);
+  if (!is(Symbol, cadr(args))) return result;
+  wchar_t *bits= stringBits(result);		if (!bits) { fprintf(stderr, "concat-symbols: non-symbol argument: ");  fdumpln(stderr, result);  fatal(0); }
+  buffer_reset(&buf);
+  buffer_appendAll(&buf, bits);
+  for (args= cdr(args);  is(Symbol, car(args));  args= cdr(args))
+    buffer_appendAll(&buf, get(getHead(args), Symbol,bits));
+  return intern(buffer_contents(&buf));
+}
+
+static subr(array_string)
+{
+  arity1(args, "array->string");
+  oop arr= getHead(args);		if (!is(Array, arr)) { fprintf(stderr, "array->string: non-array argument: ");  fdumpln(stderr, arr);  fatal(0); }
+  int len= arrayLength(arr), i;
+  oop str= _newString(len);
+  oop *elts= (oop *)get(arr, Array,_array);
+  wchar_t *bits= get(str, String,bits);
+  for (i= 0;  i < len;  ++i) {
+    if (!isLong(elts[i])) { fprintf(stderr, "array->string: non-character element: ");  fdumpln(stderr, elts[i]);  fatal(0); }
+    bits[i]= getLong(elts[i]);
+  }
+  return str;
+}
+
+static subr(list_string)
+{
+  arity1(args, "list->string");
+  oop lst= getHead(args);
+  int len= 0;
+  oop ptr;
+  for (ptr= lst;  is(Pair, ptr);  ptr= getTail(ptr)) ++len;
+  oop str= _newString(len);
+  wchar_t *bits= get(str, String,bits);
+  for (ptr= lst;  is(Pair, ptr);  ptr= getTail(ptr)) {
+    if (!isLong(getHead(ptr))) { fprintf(stderr, "list->string: non-character element: ");  fdumpln(stderr, getHead(ptr));  fatal(0); }
+    *bits++= getLong(getHead(ptr));
+  }
+  return str;
+}
+
 static subr(string_compare)	// string substring offset=0 length=strlen(substring)
 {
   oop str= car(args);			if (!is(String, str)) { fprintf(stderr, "string-compare: non-string argument: ");  fdumpln(stderr, str);  fatal(0); }
@@ -2376,6 +3084,279 @@ static subr(data_length)
   return newLong(GC_size(arg));
 }
 
+static long longArg(oop args, char *who, char *what)
+{
+  oop arg= car(args);			if (!isLong(arg)) { fprintf(stderr, "%s: non-integer %s: ", who, what);  fdumpln(stderr, arg);  fatal(0); }
+  return getLong(arg);
+}
+
+static oop copyData(oop args, char *who)
+{
+  oop  dst=  car(args);
+  long doff= longArg(cdr(args), who, "offset");
+  oop  src=  caddr(args);
+  long soff= longArg(cdr(cddr(args)), who, "offset");
+  long num=  longArg(cddr(cddr(args)), who, "count");
+  char *to=   dataSpan(dst, doff, num, who);
+  char *from= dataSpan(src, soff, num, who);
+  memmove(to, from, num);
+  return dst;
+}
+
+static subr(memcpy)	{ return copyData(args, "memcpy"); }
+static subr(memmove)	{ return copyData(args, "memmove"); }
+
+static subr(data_fill)
+{
+  oop  buf= car(args);
+  long val= longArg(cdr(args), "data-fill", "value");
+  size_t count;
+  char  *addr= dataRange(buf, cddr(args), &count, "data-fill");
+  memset(addr, val, count);
+  return buf;
+}
+
+#if !defined(WIN32)
+
+/* Descriptor I/O.  Unlike the FILE* subrs above these never block
+ * once the descriptor has been made non-blocking: fd-read and fd-write
+ * answer the number of bytes transferred (0 at end of file), nil if the
+ * operation would block or was interrupted, and -1 on any other error
+ * (errno is left for perror).
+ */
+
+static subr(fd_nonblocking)
+{
+  oop fd= car(args);			if (!isLong(fd)) { fprintf(stderr, "fd-nonblocking: non-integer descriptor: ");  fdumpln(stderr, fd);  fatal(0); }
+  int flags= fcntl(getLong(fd), F_GETFL);
+  if (flags < 0) return newLong(-1);
+  if (is(Pair, cdr(args)) && nil == cadr(args))	flags &= ~O_NONBLOCK;
+  else						flags |=  O_NONBLOCK;
+  return newLong(fcntl(getLong(fd), F_SETFL, flags));
+}
+
+static void *fdBuffer(oop args, size_t *count, char *who)
+{
+  oop fd= car(args);			if (!isLong(fd)) { fprintf(stderr, "%s: non-integer descriptor: ", who);  fdumpln(stderr, fd);  fatal(0); }
+  return dataRange(cadr(args), cddr(args), count, who);
+}
+
+static oop fdResult(ssize_t n)
+{
+  if (n >= 0) return newLong(n);
+  if (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno) return nil;
+  return newLong(-1);
+}
+
+/* read() is taken by the reader, so transfers go through readv() and writev() */
+
+static subr(fd_read)
+{
+  struct iovec iov;
+  iov.iov_base= fdBuffer(args, &iov.iov_len, "fd-read");
+  return fdResult(readv(getLong(car(args)), &iov, 1));
+}
+
+static subr(fd_write)
+{
+  struct iovec iov;
+  iov.iov_base= fdBuffer(args, &iov.iov_len, "fd-write");
+  return fdResult(writev(getLong(car(args)), &iov, 1));
+}
+
+#if defined(__linux__)
+static void eventForget(long fd);
+#endif
+
+static subr(fd_close)
+{
+  oop fd= car(args);			if (!isLong(fd)) { fprintf(stderr, "fd-close: non-integer descriptor: ");  fdumpln(stderr, fd);  fatal(0); }
+#if defined(__linux__)
+  eventForget(getLong(fd));
+#endif
+  return newLong(close(getLong(fd)));
+}
+
+#endif
+
+#if defined(__linux__)
+
+#include <sys/epoll.h>
+#include <time.h>
+
+/* Event loop.  eventHandlers is indexed by descriptor and holds
+ * (readable . writable) callback pairs; eventTimers is a list of
+ * (deadline id . callback) sorted by deadline in milliseconds.  Callbacks
+ * for descriptors receive the descriptor, timer callbacks receive their
+ * id.  A program runs the loop with (while (event-poll)), which ends when
+ * no descriptors or timers remain registered.  fd-close unregisters the
+ * descriptor it closes.
+ */
+
+static int  eventFd=      -1;
+static long eventWatched=  0;
+static long eventTimerId=  0;
+static oop  eventHandlers= 0;
+static oop  eventTimers=   0;
+
+static long eventNow(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static oop eventHandler(long fd)
+{
+  if (fd < arrayLength(eventHandlers)) {
+    oop pair= arrayAt(eventHandlers, fd);
+    if (is(Pair, pair)) return pair;
+  }
+  return nil;
+}
+
+static oop eventWatch(oop args, int readable, char *who)
+{
+  oop fd= car(args);			if (!isLong(fd)) { fprintf(stderr, "%s: non-integer descriptor: ", who);  fdumpln(stderr, fd);  fatal(0); }
+  oop callback= cadr(args);
+  long n= getLong(fd);
+  if (n < 0) fatal("%s: negative descriptor %ld", who, n);
+  if (eventFd < 0 && (eventFd= epoll_create1(EPOLL_CLOEXEC)) < 0) { perror(who);  fatal(0); }
+  oop pair= eventHandler(n);
+  int before= (nil != pair) && (nil != getHead(pair) || nil != getTail(pair));
+  if (nil == pair) {
+    if (nil == callback) return nil;
+    GC_PROTECT(callback);
+    pair= newPair(nil, nil);
+    GC_PROTECT(pair);
+    arrayAtPut(eventHandlers, n, pair);
+    GC_UNPROTECT(pair);
+    GC_UNPROTECT(callback);
+  }
+  if (readable)	setHead(pair, callback);
+  else		setTail(pair, callback);
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.data.fd= n;
+  if (nil != getHead(pair)) ev.events |= EPOLLIN;
+  if (nil != getTail(pair)) ev.events |= EPOLLOUT;
+  int status;
+  if (!ev.events) {
+    arrayAtPut(eventHandlers, n, nil);
+    status= before ? epoll_ctl(eventFd, EPOLL_CTL_DEL, n, &ev) : 0;
+    if (before) --eventWatched;
+  }
+  else if (before)
+    status= epoll_ctl(eventFd, EPOLL_CTL_MOD, n, &ev);
+  else {
+    status= epoll_ctl(eventFd, EPOLL_CTL_ADD, n, &ev);
+    if (status == 0) ++eventWatched;
+  }
+  if (status < 0) {
+    if (ev.events && !before) arrayAtPut(eventHandlers, n, nil);
+    return newLong(-1);
+  }
+  return fd;
+}
+
+static void eventForget(long fd)
+{
+  if (nil != eventHandler(fd)) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    epoll_ctl(eventFd, EPOLL_CTL_DEL, fd, &ev);
+    arrayAtPut(eventHandlers, fd, nil);
+    --eventWatched;
+  }
+}
+
+static subr(event_readable)	{ return eventWatch(args, 1, "event-readable"); }
+static subr(event_writable)	{ return eventWatch(args, 0, "event-writable"); }
+
+static subr(event_timeout)
+{
+  oop msecs= car(args);			if (!isLong(msecs)) { fprintf(stderr, "event-timeout: non-integer delay: ");  fdumpln(stderr, msecs);  fatal(0); }
+  oop callback= cadr(args);
+  long deadline= eventNow() + getLong(msecs);
+  oop  id= nil;
+  oop  timer= nil;
+  GC_PROTECT(callback);
+  GC_PROTECT(id);
+  GC_PROTECT(timer);
+  id= newLong(++eventTimerId);
+  timer= newPair(id, callback);
+  timer= newPair(newLong(deadline), timer);
+  oop *link= &eventTimers;
+  while (is(Pair, *link) && getLong(getHead(getHead((*link)))) <= deadline) link= &get((*link), Pair,tail);
+  *link= newPair(timer, *link);
+  GC_UNPROTECT(timer);
+  GC_UNPROTECT(id);
+  GC_UNPROTECT(callback);
+  return id;
+}
+
+static subr(event_cancel)
+{
+  oop id= car(args);			if (!isLong(id)) { fprintf(stderr, "event-cancel: non-integer timer: ");  fdumpln(stderr, id);  fatal(0); }
+  oop *link= &eventTimers;
+  while (is(Pair, *link)) {
+    if (getLong(getHead(getTail(getHead((*link))))) == getLong(id)) {
+      *link= getTail((*link));
+      return id;
+    }
+    link= &get((*link), Pair,tail);
+  }
+  return nil;
+}
+
+static subr(event_poll)
+{
+  oop arg= car(args);
+  if (nil != arg && !isLong(arg)) { fprintf(stderr, "event-poll: non-integer timeout: ");  fdumpln(stderr, arg);  fatal(0); }
+  if (!eventWatched && nil == eventTimers) return nil;
+  long timeout= (nil == arg) ? -1 : getLong(arg);
+  if (nil != eventTimers) {
+    long due= getLong(getHead(getHead(eventTimers))) - eventNow();
+    if (due < 0) due= 0;
+    if (timeout < 0 || due < timeout) timeout= due;
+  }
+  long dispatched= 0;
+  if (eventWatched) {
+    struct epoll_event events[64];
+    int n= epoll_wait(eventFd, events, 64, timeout);
+    if (n < 0 && EINTR != errno) { perror("event-poll");  fatal(0); }
+    int i;
+    for (i= 0;  i < n;  ++i) {
+      long fd= events[i].data.fd;
+      oop  pair;
+      if ((events[i].events & (EPOLLIN  | EPOLLHUP | EPOLLERR)) && nil != (pair= eventHandler(fd)) && nil != getHead(pair)) {
+	apply(getHead(pair), newPair(newLong(fd), nil), nil);
+	++dispatched;
+      }
+      if ((events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && nil != (pair= eventHandler(fd)) && nil != getTail(pair)) {
+	apply(getTail(pair), newPair(newLong(fd), nil), nil);
+	++dispatched;
+      }
+    }
+  }
+  else if (timeout > 0) {
+    struct timespec ts= { timeout / 1000, (timeout % 1000) * 1000000 };
+    nanosleep(&ts, 0);
+  }
+  long now= eventNow();
+  while (is(Pair, eventTimers) && getLong(getHead(getHead(eventTimers))) <= now) {
+    oop timer= getHead(eventTimers);
+    eventTimers= getTail(eventTimers);
+    GC_PROTECT(timer);
+    apply(getTail(getTail(timer)), newPair(getHead(getTail(timer)), nil), nil);
+    GC_UNPROTECT(timer);
+    ++dispatched;
+  }
+  return newLong(dispatched);
+}
+
+#endif
+
 static void idxtype(oop args, char *who)
 {
     fprintf(stderr, "\n%s: non-integer index: ", who);
@@ -2454,6 +3435,18 @@ accessor(longdouble,	Double,	 long double)
 # include <sys/mman.h>
 #endif
 
+static void *makeExecutable(oop data)
+{
+#if !defined(WIN32)
+    extern int getpagesize();
+    void  *addr  = data;
+    void  *start = (void *)((long)addr & -(long)getpagesize());	// round down to page boundary for Darwin
+    size_t len   = (addr + GC_size(data)) - start;
+    if (mprotect(start, len, PROT_READ | PROT_WRITE | PROT_EXEC)) perror("mprotect");
+#endif
+    return data;
+}
+
 static subr(native_call)
 {
     oop  obj= car(args);
@@ -2481,22 +3474,13 @@ static subr(native_call)
 	++argc;
     }
     void  *addr= 0;
-    size_t size= 0;
     switch (getType(obj))
     {
-	case Data:	addr= obj;			size= GC_size(obj);	break;
-	case Long:	addr= (void *)getLong(obj);				break;
-	case Subr:	addr= get(obj, Subr,imp);				break;
+	case Data:	addr= makeExecutable(obj);			break;
+	case Long:	addr= (void *)getLong(obj);			break;
+	case Subr:	addr= get(obj, Subr,imp);			break;
 	default:	fatal("call: cannot call object of type %i", getType(obj));
     }
-    if (size) {
-#     if !defined(WIN32)
-	extern int getpagesize();
-	void *start = (void *)((long)addr & -(long)getpagesize());	// round down to page boundary for Darwin
-	size_t len  = (addr + size) - start;
-	if (mprotect(start, len, PROT_READ | PROT_WRITE | PROT_EXEC)) perror("mprotect");
-#     endif
-    }
     return newLong(((int (*)())addr)(argv));
 }
 
@@ -2512,15 +3496,22 @@ static subr(subr)
 {
     oop arg= car(args);
     wchar_t *name= 0;
+    void *addr= 0;
+    if (is(Data, arg)) {			// (subr code signature name) calls machine code in code
+	addr= makeExecutable(arg);
+	arg=  caddr(args);
+    }
     switch (getType(arg))
     {
 	case String:	name= get(arg, String,bits);  break;
 	case Symbol:	name= get(arg, Symbol,bits);  break;
 	default:	fatal("subr: argument must be string or symbol");
     }
-    char *sym= wcs2mbs(name);
-    void *addr= dlsym(RTLD_DEFAULT, sym);
-    if (!addr) fatal("could not find symbol: %s", sym);
+    if (!addr) {
+	char *sym= wcs2mbs(name);
+	addr= dlsym(RTLD_DEFAULT, sym);
+	if (!addr) fatal("could not find symbol: %s", sym);
+    }
     proto_t *sig= 0;
     arg= cadr(args);
     if (nil != arg) {				if (!is(String, arg)) { fprintf(stderr, "subr: non-String signature: ");  fdumpln(stderr, arg);  fatal(0); }
@@ -3005,10 +3996,15 @@ static subr_ent_t subr_tab[] = {
 //  { " current-environment",	subr_current_environment },
     { " open",			subr_open },
     { " close",			subr_close },
+    { " flush",			subr_flush },
+    { " open-output-string",	subr_open_output_string },
+    { " get-output-string",	subr_get_output_string },
     { " getb",			subr_getb },
     { " getc",			subr_getc },
     { " putb",			subr_putb },
     { " putc",			subr_putc },
+    { " read-bytes",		subr_read_bytes },
+    { " write-bytes",		subr_write_bytes },
     { " read",			subr_read },
     { " expand",		subr_expand },
     { " encode",		subr_encode },
@@ -3019,6 +4015,7 @@ static subr_ent_t subr_tab[] = {
     { " print",			subr_print },
     { " dump",			subr_dump },
     { " format",		subr_format },
+    { " printf",		subr_printf },
     { " form",			subr_form },
     { " fixed?",		subr_fixedP },
     { " cons",			subr_cons },
@@ -3036,6 +4033,13 @@ static subr_ent_t subr_tab[] = {
     { " set-string-at",		subr_set_string_at },
     { " string-copy",		subr_string_copy },
     { " string-compare",	subr_string_compare },
+    { " string-append",		subr_string_append },
+    { " concat-string",		subr_concat_string },
+    { " concat-strings",	subr_concat_strings },
+    { " concat-symbol",		subr_concat_symbol },
+    { " concat-symbols",	subr_concat_symbols },
+    { " array->string",		subr_array_string },
+    { " list->string",		subr_list_string },
     { " symbol->string", 	subr_symbol_string },
     { " string->symbol", 	subr_string_symbol },
     { " symbol-compare", 	subr_symbol_compare },
@@ -3053,6 +4057,22 @@ static subr_ent_t subr_tab[] = {
     { " array-compare",		subr_array_compare },
     { " data",			subr_data },
     { " data-length",		subr_data_length },
+    { " memcpy",		subr_memcpy },
+    { " memmove",		subr_memmove },
+    { " data-fill",		subr_data_fill },
+#if !defined(WIN32)
+    { " fd-nonblocking",	subr_fd_nonblocking },
+    { " fd-read",		subr_fd_read },
+    { " fd-write",		subr_fd_write },
+    { " fd-close",		subr_fd_close },
+#endif
+#if defined(__linux__)
+    { " event-readable",	subr_event_readable },
+    { " event-writable",	subr_event_writable },
+    { " event-timeout",		subr_event_timeout },
+    { " event-cancel",		subr_event_cancel },
+    { " event-poll",		subr_event_poll },
+#endif
     { " byte-at",		subr_byte_at },
     { " set-byte-at",		subr_set_byte_at },
     { " char-at",		subr_char_at },
@@ -3133,8 +4153,15 @@ int main(int argc, char **argv)
   GC_add_root(&arguments);
   GC_add_root(&input);
   GC_add_root(&output);
+  GC_add_root(&tierCompiler);
+  GC_add_root(&tierThreshold);
+  GC_add_root(&tierExpr);
 
   symbols= newArray(0);
+#if defined(__linux__)
+  eventHandlers= newArray(0);		GC_add_root(&eventHandlers);
+  eventTimers= nil;			GC_add_root(&eventTimers);
+#endif
 
   s_set			= intern(L"set");			GC_add_root(&s_set		);
   s_define		= intern(L"define");			GC_add_root(&s_define		);
@@ -3166,6 +4193,9 @@ int main(int argc, char **argv)
   input=	define(get(globals, Variable,value), intern(L"*input*"), nil);
   output=	define(get(globals, Variable,value), intern(L"*output*"), nil);
 
+  tierCompiler=	define(get(globals, Variable,value), intern(L"*tier-compiler*"),  nil);
+  tierThreshold=define(get(globals, Variable,value), intern(L"*tier-threshold*"), newLong(1000));
+
   currentPath= nil;			GC_add_root(&currentPath);
   currentLine= nil;			GC_add_root(&currentLine);
   currentSource= newPair(nil, nil);	GC_add_root(&currentSource);
@@ -3210,6 +4240,8 @@ int main(int argc, char **argv)
 
 #endif
 
+  set(output, Variable,value, newLong((long)stdout));
+
   {
       tmp= nil;		GC_PROTECT(tmp);
 
@@ -3292,8 +4324,6 @@ int main(int argc, char **argv)
 #endif
   }
 
-  set(output, Variable,value, newLong((long)stdout));
-
   if (!repled) {
     if (!opt_b) replPath(L"boot.l");
     replFile(stdin, L"<stdin>");
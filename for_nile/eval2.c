@@ -11,6 +11,7 @@
 #include <errno.h>
 #include <math.h>
 #include <signal.h>
+#include <wctype.h>
 
 // #include <stddef.h>
 // #include <string.h>
@@ -407,7 +408,6 @@ static oop newSubr(wchar_t *name, imp_t imp, proto_t *sig)
 //   return obj;
 // }
 
-static void dump(oop);
 static void dumpln(oop);
 
 // static oop findLocalVariable(oop env, oop name)
@@ -870,6 +870,16 @@ static oop readExpr(FILE *fp)
     }
 }
 
+/* stdout and string output streams are byte oriented: write wide
+ * characters to them as multibyte sequences rather than with putwc */
+
+static wint_t putwch(wint_t c, FILE *stream)
+{
+    if (fwide(stream, 0) > 0) return putwc(c, stream);
+    if (c < 0x80) return (EOF == putc(c, stream)) ? WEOF : c;
+    return (fprintf(stream, "%lc", c) < 0) ? WEOF : c;
+}
+
 static void doprint(FILE *stream, oop obj, int storing)
 {
     if (!obj) {
@@ -908,9 +918,9 @@ static void doprint(FILE *stream, oop obj, int storing)
 		while ((c= *p++)) {
 		    if (c >= ' ')
 			switch (c) {
-			    case '"':  printf("\\\"");	break;
-			    case '\\': printf("\\\\");	break;
-			    default:	 putwc(c, stream);  break;
+			    case '"':  fprintf(stream, "\\\"");	break;
+			    case '\\': fprintf(stream, "\\\\");	break;
+			    default:	 putwch(c, stream);  break;
 			}
 		    else fprintf(stream, "\\%03o", c);
 		}
@@ -1058,17 +1068,17 @@ static void doprint(FILE *stream, oop obj, int storing)
 #endif
 }
 
-static void fprint(FILE *stream, oop obj)	{ doprint(stream, obj, 0);  fflush(stream); }
-static void print(oop obj)			{ fprint(stdout, obj); }
+/* printing does not flush: output streams are flushed explicitly (flush
+ * subr), before reading from the console, on fatal errors and at exit */
 
-static void fdump(FILE *stream, oop obj)	{ doprint(stream, obj, 1);  fflush(stream); }
-static void dump(oop obj)			{ fdump(stdout, obj); }
+static void fprint(FILE *stream, oop obj)	{ doprint(stream, obj, 0); }
+
+static void fdump(FILE *stream, oop obj)	{ doprint(stream, obj, 1); }
 
 static void fdumpln(FILE *stream, oop obj)
 {
     fdump(stream, obj);
     fprintf(stream, "\n");
-    fflush(stream);
 }
 
 static void dumpln(oop obj)			{ fdumpln(stdout, obj); }
@@ -1478,6 +1488,7 @@ static void oprintf(char *fmt, ...)
 
 static void fatal(char *reason, ...)
 {
+    fflush(0);
     if (reason) {
 	va_list ap;
 	va_start(ap, reason);
@@ -2143,11 +2154,72 @@ static subr(open)
     return stream ? newLong((long)stream) : nil;
 }
 
+typedef struct strout
+{
+    FILE		*stream;
+    char		*bits;
+    size_t		 size;
+    struct strout	*next;
+} strout_t;
+
+static strout_t *strouts= 0;
+
+static strout_t *findStrout(FILE *stream)
+{
+    strout_t *s;
+    for (s= strouts;  s;  s= s->next)
+	if (stream == s->stream) return s;
+    return 0;
+}
+
+static subr(open_output_string)
+{
+    strout_t *s= calloc(1, sizeof(strout_t));
+    if (!s || !(s->stream= open_memstream(&s->bits, &s->size))) {
+	free(s);
+	return nil;
+    }
+    fwide(s->stream, -1);
+    s->next= strouts;
+    strouts= s;
+    return newLong((long)s->stream);
+}
+
+static subr(get_output_string)
+{
+    oop arg= car(args);
+    if (nil == arg) arg= getVar(output);
+    if (!isLong(arg)) { fprintf(stderr, "get-output-string: non-integer argument: ");  fdumpln(stderr, arg);  fatal(0); }
+    strout_t *s= findStrout((FILE *)getLong(arg));
+    if (!s) { fprintf(stderr, "get-output-string: not a string output stream: ");  fdumpln(stderr, arg);  fatal(0); }
+    fflush(s->stream);
+    return newString(mbs2wcs(s->bits));
+}
+
 static subr(close)
 {
     oop arg= car(args);
     if (!isLong(arg)) { fprintf(stderr, "close: non-integer argument: ");  fdumpln(stderr, arg);  fatal(0); }
-    fclose((FILE *)getLong(arg));
+    FILE *stream= (FILE *)getLong(arg);
+    fclose(stream);
+    strout_t **sp;
+    for (sp= &strouts;  *sp;  sp= &(*sp)->next)
+	if (stream == (*sp)->stream) {
+	    strout_t *s= *sp;
+	    *sp= s->next;
+	    free(s->bits);
+	    free(s);
+	    break;
+	}
+    return arg;
+}
+
+static subr(flush)
+{
+    oop arg= car(args);
+    if (nil == arg) arg= getVar(output);
+    if (!isLong(arg)) { fprintf(stderr, "flush: non-integer argument: ");  fdumpln(stderr, arg);  fatal(0); }
+    fflush((FILE *)getLong(arg));
     return arg;
 }
 
@@ -2191,7 +2263,7 @@ static subr(putc)
     if (!isLong(chr)) { fprintf(stderr, "putc: non-integer character: ");  fdumpln(stderr, chr);  fatal(0); }
     if (!isLong(arg)) { fprintf(stderr, "putc: non-integer argument: ");  fdumpln(stderr, arg);  fatal(0); }
     FILE *stream= (FILE *)getLong(arg);
-    int c= putwc(getLong(chr), stream);
+    int c= putwch(getLong(chr), stream);
     return (WEOF == c) ? nil : chr;
 }
 
@@ -2200,6 +2272,7 @@ static subr(read)
     FILE *stream= stdin;
     oop   head= nil;
     if (nil == args) {
+	fflush(stdout);
 	beginSource(L"<stdin>");
 	oop obj= readExpr(stdin);
 	endSource();
@@ -2300,10 +2373,17 @@ static subr(type_of)
 //   return nil;
 // }
 
+static FILE *outputStream(void)
+{
+    oop stream= getVar(output);
+    return isLong(stream) ? (FILE *)getLong(stream) : stdout;
+}
+
 static subr(print)
 {
+    FILE *stream= outputStream();
     while (is(Pair, args)) {
-	print(getHead(args));
+	fprint(stream, getHead(args));
 	args= getTail(args);
     }
     return nil;
@@ -2311,50 +2391,137 @@ static subr(print)
 
 static subr(dump)
 {
+    FILE *stream= outputStream();
     while (is(Pair, args)) {
-	dump(getHead(args));
+	fdump(stream, getHead(args));
 	args= getTail(args);
     }
     return nil;
 }
 
-static subr(format)
-{
-    arity2(args, "format");
-    oop     ofmt= car(args);		if (!is(String, ofmt)) fatal("format is not a string");
-    oop     oarg= cadr(args);
-    wchar_t *fmt= get(ofmt, String,bits);
-    int     farg= 0;
-    union { long l;  void *p;	double d; } arg;
-    switch (getType(oarg)) {
-	case Undefined:					  break;
-	case Long:	arg.l= getLong(oarg);		  break;
-	case Double:	arg.d= getDouble(oarg);	 ++farg;  break;
-	case String:	arg.p= get(oarg, String,bits);	  break;
-	case Symbol:	arg.p= get(oarg, Symbol,bits);	  break;
-	default:	arg.p= oarg;			  break;
-    }
-    size_t size= 100;
-    wchar_t *p, *np;
-    oop ans= nil;
-    if (!(p= malloc(sizeof(wchar_t) * size))) return nil;
-    for (;;) {
-	int n= farg ? swnprintf(p, size, fmt, arg.d) : swnprintf(p, size, fmt, arg);
-	if (0 <= n && n < size) {
-	    ans= newString(p);
-	    free(p);
-	    break;
+/* format a list of arguments according to the printf-style directives in
+ * fmt, appending the result to buf.  integer directives take Longs (and
+ * are always formatted as longs), floating-point directives take Doubles
+ * or Longs, %s and %ls print Strings and Symbols as they are and any other
+ * object as print would, and * widths and precisions are taken from the
+ * argument list. */
+
+static void formatArgs(struct buffer *buf, wchar_t *fmt, oop args, char *who)
+{
+    while (*fmt) {
+	if ('%' != *fmt)   { buffer_append(buf, *fmt++);  continue; }
+	if ('%' == fmt[1]) { buffer_append(buf, '%');  fmt += 2;  continue; }
+	wchar_t spec[64];
+	int     n= 0, width= 0, prec= -1, left= 0;
+	spec[n++]= *fmt++;
+	while (*fmt && wcschr(L"-+ #0", *fmt)) {
+	    if ('-' == *fmt) left= 1;
+	    if (n < 8) spec[n++]= *fmt;
+	    ++fmt;
 	}
-	if (n < 0 && errno == EILSEQ) return nil;
-	if (n >= 0)	size= n + 1;
-	else	size *= 2;
-	if (!(np= realloc(p, sizeof(wchar_t) * size))) {
-	    free(p);
-	    break;
+	if ('*' == *fmt) {
+	    oop arg= car(args);  args= cdr(args);
+	    if (!isLong(arg)) { fprintf(stderr, "%s: non-integer width: ", who);  fdumpln(stderr, arg);  fatal(0); }
+	    ++fmt;
+	    if ((width= getLong(arg)) < 0) width= -width, left= 1, spec[n++]= '-';
 	}
-	p= np;
+	else
+	    while (iswdigit(*fmt)) width= width * 10 + *fmt++ - '0';
+	if ('.' == *fmt) {
+	    ++fmt;
+	    if ('*' == *fmt) {
+		oop arg= car(args);  args= cdr(args);
+		if (!isLong(arg)) { fprintf(stderr, "%s: non-integer precision: ", who);  fdumpln(stderr, arg);  fatal(0); }
+		++fmt;
+		prec= getLong(arg);
+	    }
+	    else
+		for (prec= 0;  iswdigit(*fmt);  ++fmt) prec= prec * 10 + *fmt - '0';
+	}
+	while (*fmt && wcschr(L"hlLqjzt", *fmt)) ++fmt;
+	int conv= *fmt++;
+	if (!conv) fatal("%s: incomplete directive at end of format", who);
+	if (!is(Pair, args)) fatal("%s: too few arguments", who);
+	oop arg= getHead(args);  args= getTail(args);
+	if ('s' == conv) {
+	    wchar_t *str= 0;
+	    if      (is(String, arg)) str= get(arg, String,bits);
+	    else if (is(Symbol, arg)) str= get(arg, Symbol,bits);
+	    else {
+		char   *bits= 0;
+		size_t  size= 0;
+		FILE   *stream= open_memstream(&bits, &size);
+		if (!stream) fatal("%s: cannot print argument for %%s", who);
+		fwide(stream, -1);
+		fprint(stream, arg);
+		fclose(stream);
+		str= mbs2wcs(bits);
+		free(bits);
+	    }
+	    int len= wcslen(str), pad;
+	    if (prec >= 0 && prec < len) len= prec;
+	    if (!left) for (pad= len;  pad < width;  ++pad) buffer_append(buf, ' ');
+	    for (n= 0;  n < len;  ++n) buffer_append(buf, str[n]);
+	    if (left)  for (pad= len;  pad < width;  ++pad) buffer_append(buf, ' ');
+	    continue;
+	}
+	if (width)     n += swprintf(spec + n, 64 - n, L"%d", width);
+	if (prec >= 0) n += swprintf(spec + n, 64 - n, L".%d", prec);
+	size_t   size= 400 + width + (prec > 0 ? prec : 0);	/* %f of DBL_MAX is 316 characters */
+	wchar_t  local[512];
+	wchar_t *out= (size <= 512) ? local : malloc(sizeof(wchar_t) * size);
+	int      len= 0;
+	switch (conv) {
+	    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+		if (!isLong(arg)) { fprintf(stderr, "%s: non-integer argument for %%%lc: ", who, conv);  fdumpln(stderr, arg);  fatal(0); }
+		spec[n++]= 'l';  spec[n++]= conv;  spec[n]= 0;
+		len= swprintf(out, size, spec, getLong(arg));
+		break;
+	    case 'c':
+		if (!isLong(arg)) { fprintf(stderr, "%s: non-integer argument for %%c: ", who);  fdumpln(stderr, arg);  fatal(0); }
+		spec[n++]= 'l';  spec[n++]= 'c';  spec[n]= 0;
+		len= swprintf(out, size, spec, (wint_t)getLong(arg));
+		break;
+	    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A': {
+		double d= 0;
+		if      (isDouble(arg)) d= getDouble(arg);
+		else if (isLong(arg))   d= getLong(arg);
+		else { fprintf(stderr, "%s: non-numeric argument for %%%lc: ", who, conv);  fdumpln(stderr, arg);  fatal(0); }
+		spec[n++]= conv;  spec[n]= 0;
+		len= swprintf(out, size, spec, d);
+		break;
+	    }
+	    case 'p':
+		spec[n++]= 'p';  spec[n]= 0;
+		len= swprintf(out, size, spec, isLong(arg) ? (void *)getLong(arg) : (void *)arg);
+		break;
+	    default:
+		fatal("%s: unknown directive '%%%lc'", who, conv);
+	}
+	if (len < 0) fatal("%s: cannot format '%ls'", who, spec);
+	int i;
+	for (i= 0;  i < len;  ++i) buffer_append(buf, out[i]);
+	if (out != local) free(out);
     }
-    return ans;
+}
+
+static subr(format)
+{
+    static struct buffer buf= BUFFER_INITIALISER;
+    oop     ofmt= car(args);		if (!is(String, ofmt)) fatal("format is not a string");
+    buffer_reset(&buf);
+    formatArgs(&buf, get(ofmt, String,bits), cdr(args), "format");
+    return newString(buffer_contents(&buf));
+}
+
+static subr(printf)
+{
+    static struct buffer buf= BUFFER_INITIALISER;
+    oop     ofmt= car(args);		if (!is(String, ofmt)) fatal("printf: format is not a string");
+    buffer_reset(&buf);
+    formatArgs(&buf, get(ofmt, String,bits), cdr(args), "printf");
+    fprintf(outputStream(), "%ls", buffer_contents(&buf));
+    return newLong(buf.position);
 }
 
 static subr(form)
@@ -2478,6 +2645,150 @@ static subr(set_string_at)
     return val;
 }
 
+/* a String doubles as a string builder: string-append grows it in place,
+ * keeping spare capacity at the end of its bits (as arrays do for their
+ * elements) so that appending is amortised O(1) and the finished string
+ * needs no further copying. */
+
+static wchar_t *stringBits(oop obj)
+{
+    if (is(String, obj)) return get(obj, String,bits);
+    if (is(Symbol, obj)) return get(obj, Symbol,bits);
+    return 0;
+}
+
+static int stringBitsLength(oop obj)
+{
+    return is(String, obj) ? stringLength(obj) : wcslen(get(obj, Symbol,bits));
+}
+
+static oop stringAppend(oop str, wchar_t *chars, int n)
+{
+    int      len=  stringLength(str);
+    wchar_t *bits= get(str, String,bits);
+    int      cap=  GC_size(bits) / sizeof(wchar_t) - 1;
+    if (len + n > cap) {
+	if (cap < 8) cap= 8;
+	while (cap < len + n) cap *= 2;
+	GC_PROTECT(str);
+	wchar_t *gstr= (wchar_t *)_newBits(-1, sizeof(wchar_t) * (cap + 1));
+	GC_UNPROTECT(str);
+	wmemcpy(gstr, bits, len);
+	set(str, String,bits, bits= gstr);
+    }
+    wmemcpy(bits + len, chars, n);
+    bits[len + n]= 0;
+    set(str, String,size, newLong(len + n));
+    return str;
+}
+
+static subr(string_append)
+{
+    oop str= car(args);			if (!is(String, str)) { fprintf(stderr, "string-append: non-string argument: ");  fdumpln(stderr, str);  fatal(0); }
+    for (args= getTail(args);  is(Pair, args);  args= getTail(args)) {
+	oop arg= getHead(args);
+	if (isLong(arg)) {
+	    wchar_t c= getLong(arg);
+	    stringAppend(str, &c, 1);
+	}
+	else {
+	    wchar_t *bits= stringBits(arg);	if (!bits) { fprintf(stderr, "string-append: non-character/string argument: ");  fdumpln(stderr, arg);  fatal(0); }
+	    stringAppend(str, bits, stringBitsLength(arg));
+	}
+    }
+    return str;
+}
+
+static oop concatStringsN(oop args, int n, char *who)
+{
+    int len= 0, i;
+    oop arg= args;
+    for (i= 0;  i < n;  ++i, arg= getTail(arg)) {
+	if (!stringBits(getHead(arg))) { fprintf(stderr, "%s: non-string argument: ", who);  fdumpln(stderr, getHead(arg));  fatal(0); }
+	len += stringBitsLength(getHead(arg));
+    }
+    oop      str=  _newString(len);
+    wchar_t *bits= get(str, String,bits);
+    for (i= 0;  i < n;  ++i, args= getTail(args)) {
+	int l= stringBitsLength(getHead(args));
+	wmemcpy(bits, stringBits(getHead(args)), l);
+	bits += l;
+    }
+    return str;
+}
+
+static subr(concat_string)
+{
+    arity2(args, "concat-string");
+    return concatStringsN(args, 2, "concat-string");
+}
+
+static subr(concat_strings)
+{
+    int n= 1;
+    oop arg= cdr(args);
+    while (is(String, car(arg))) ++n, arg= cdr(arg);
+    if (n == 1) return car(args);
+    return concatStringsN(args, n, "concat-strings");
+}
+
+static subr(concat_symbol)
+{
+    arity2(args, "concat-symbol");
+    static struct buffer buf= BUFFER_INITIALISER;
+    buffer_reset(&buf);
+    while (is(Pair, args)) {
+	wchar_t *bits= stringBits(getHead(args));	if (!bits) { fprintf(stderr, "concat-symbol: non-symbol argument: ");  fdumpln(stderr, getHead(args));  fatal(0); }
+	buffer_appendAll(&buf, bits);
+	args= getTail(args);
+    }
+    return intern(buffer_contents(&buf));
+}
+
+static subr(concat_symbols)
+{
+    static struct buffer buf= BUFFER_INITIALISER;
+    oop result= car(args);
+    if (!is(Symbol, cadr(args))) return result;
+    wchar_t *bits= stringBits(result);		if (!bits) { fprintf(stderr, "concat-symbols: non-symbol argument: ");  fdumpln(stderr, result);  fatal(0); }
+    buffer_reset(&buf);
+    buffer_appendAll(&buf, bits);
+    for (args= cdr(args);  is(Symbol, car(args));  args= cdr(args))
+	buffer_appendAll(&buf, get(getHead(args), Symbol,bits));
+    return intern(buffer_contents(&buf));
+}
+
+static subr(array_string)
+{
+    arity1(args, "array->string");
+    oop arr= getHead(args);		if (!is(Array, arr)) { fprintf(stderr, "array->string: non-array argument: ");  fdumpln(stderr, arr);  fatal(0); }
+    int len= arrayLength(arr), i;
+    oop str= _newString(len);
+    oop *elts= (oop *)get(arr, Array,_array);
+    wchar_t *bits= get(str, String,bits);
+    for (i= 0;  i < len;  ++i) {
+	if (!isLong(elts[i])) { fprintf(stderr, "array->string: non-character element: ");  fdumpln(stderr, elts[i]);  fatal(0); }
+	bits[i]= getLong(elts[i]);
+    }
+    return str;
+}
+
+static subr(list_string)
+{
+    arity1(args, "list->string");
+    oop lst= getHead(args);
+    int len= 0;
+    oop ptr;
+    for (ptr= lst;  is(Pair, ptr);  ptr= getTail(ptr)) ++len;
+    oop str= _newString(len);
+    wchar_t *bits= get(str, String,bits);
+    for (ptr= lst;  is(Pair, ptr);  ptr= getTail(ptr)) {
+	if (!isLong(getHead(ptr))) { fprintf(stderr, "list->string: non-character element: ");  fdumpln(stderr, getHead(ptr));  fatal(0); }
+    *bits++= getLong(getHead(ptr));
+    }
+    return str;
+}
+
 // static subr(string_copy)	// string from len
 // {
 //   oop str= car(args);			if (!is(String, str)) { fprintf(stderr, "string-copy: non-string argument: ");	fdumpln(stderr, str);  fatal(0); }
@@ -3289,6 +3600,9 @@ static subr_ent_t subr_tab[] = {
 // //  { " current-environment",	subr_current_environment },
     { " open",			subr_open },
     { " close",			subr_close },
+    { " flush",			subr_flush },
+    { " open-output-string",	subr_open_output_string },
+    { " get-output-string",	subr_get_output_string },
 //     { " getb",			subr_getb },
     { " getc",			subr_getc },
 //     { " putb",			subr_putb },
@@ -3303,6 +3617,7 @@ static subr_ent_t subr_tab[] = {
     { " print",			subr_print },
     { " dump",			subr_dump },
     { " format",		subr_format },
+    { " printf",		subr_printf },
     { " form",			subr_form },
 //     { " fixed?",		subr_fixedP },
     { " cons",			subr_cons },
@@ -3320,6 +3635,13 @@ static subr_ent_t subr_tab[] = {
     { " set-string-at",		subr_set_string_at },
 //     { " string-copy",		subr_string_copy },
 //     { " string-compare",	subr_string_compare },
+    { " string-append",		subr_string_append },
+    { " concat-string",		subr_concat_string },
+    { " concat-strings",	subr_concat_strings },
+    { " concat-symbol",		subr_concat_symbol },
+    { " concat-symbols",	subr_concat_symbols },
+    { " array->string",		subr_array_string },
+    { " list->string",		subr_list_string },
     { " symbol->string",	subr_symbol_string },
     { " string->symbol",	subr_string_symbol },
 //     { " symbol-compare",	subr_symbol_compare },
@@ -3456,7 +3778,7 @@ int main(int argc, char **argv)
 
     backtrace=		define(globalNamespace, intern(L"*backtrace*"),    nil);
     input=		define(globalNamespace, intern(L"*input*"),	     nil);
-    output=		define(globalNamespace, intern(L"*output*"),	     nil);
+    output=		define(globalNamespace, intern(L"*output*"),	     newLong((long)stdout));
 
     currentPath=	nil;					GC_add_root(&currentPath);
     currentLine=	nil;					GC_add_root(&currentLine);
@@ -3581,8 +3903,6 @@ int main(int argc, char **argv)
 // #endif
 //   }
 
-    setVar(output, newLong((long)stdout));
-
     if (!repled) {
 	if (!opt_b) replPath(L"boot2.l");
 	replFile(stdin, L"<stdin>");
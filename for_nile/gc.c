@@ -97,15 +97,28 @@ static size_t	gcQuantum= GC_QUANTUM;
 static int	gcCount=   ALLOCS_PER_GC;
 static int	gcAllocs=  ALLOCS_PER_GC;
 static size_t	gcMemory=  GC_MEMORY;
+static size_t	gcHeap=    0;
 
 static gcfinaliser *finalisable= 0;
 
+struct GC_Heap
+{
+  gcheader *first, *last;	/* chain of headers, in order of allocation */
+  char	   *free, *limit;	/* of the current block */
+  size_t    used, size;		/* bytes in objects and in blocks */
+};
+
+static __thread GC_Heap *gcLocal= 0;
+
+static void *GC_heap_malloc(GC_Heap *heap, size_t lbs);
+
 //static void bkpt() {}
 
 GC_API void *GC_malloc(size_t lbs)
 {
   gcheader *hdr, *org;
   size_t split;
+  if (gcLocal) return GC_heap_malloc(gcLocal, lbs);
   if ((!--gcAllocs) || (gcMemory < lbs)) {
     //fprintf(stderr, "%i %lu %ld\t", gcAllocs, gcMemory, lbs);
 #  if VERBOSE >= 1
@@ -172,7 +185,9 @@ GC_API void *GC_malloc(size_t lbs)
   {
     size_t incr= gcQuantum;
     size_t req= sizeof(gcheader) + lbs;
-    while (incr <= req) incr *= 2;
+    /* every extension follows a scan of the whole ring, so grow in
+       proportion to the heap when it is full of live objects */
+    while (incr <= req || incr < gcHeap / 4) incr *= 2;
     //fprintf(stderr, "extending by %ld => %ld @ %d\n", req, incr, (int)(gcCount - gcAllocs));
     hdr= (gcheader *)malloc(incr);
     //fprintf(stderr, "buffer at %x\n", (int)hdr);
@@ -182,6 +197,7 @@ GC_API void *GC_malloc(size_t lbs)
 	hdr->next= gcbase.next;
 	gcbase.next= hdr;
 	hdr->size= incr - sizeof(gcheader);
+	gcHeap += incr;
 #if VERBOSE
 	fprintf(stderr, "extend by %i at %p\n", (int)hdr->size, hdr);
 #endif
@@ -233,6 +249,84 @@ GC_API void GC_free(void *ptr)
   gcnext= GC_freeHeader(ptr2hdr(ptr));
 }
 
+/* A private heap fills malloc()ed blocks with objects, in order, and ends
+ * each block with a free header over the space left in it.  Nothing in it
+ * is collected (or marked) until it is merged into the shared heap. */
+
+GC_API GC_Heap *GC_new_heap(void)
+{
+  GC_Heap *heap= calloc(1, sizeof(GC_Heap));
+  if (!heap) {
+    fprintf(stderr, "GC: out of memory\n");
+    abort();
+  }
+  return heap;
+}
+
+GC_API void GC_use_heap(GC_Heap *heap)
+{
+  gcLocal= heap;
+}
+
+static void GC_heap_append(GC_Heap *heap, gcheader *hdr, size_t lbs)
+{
+  memset(hdr, 0, sizeof(gcheader));
+  hdr->size= lbs;
+  if (heap->last)
+    heap->last->next= hdr;
+  else
+    heap->first= hdr;
+  heap->last= hdr;
+  heap->free += sizeof(gcheader) + lbs;
+}
+
+static void GC_heap_close(GC_Heap *heap)
+{
+  if (heap->free)
+    GC_heap_append(heap, (gcheader *)heap->free, heap->limit - heap->free - sizeof(gcheader));
+}
+
+static void *GC_heap_malloc(GC_Heap *heap, size_t lbs)
+{
+  gcheader *hdr;
+  size_t req;
+  lbs= (lbs + GC_ALIGN-1) & ~(GC_ALIGN-1);
+  req= sizeof(gcheader) + lbs + sizeof(gcheader);	/* and room to close the block */
+  if ((size_t)(heap->limit - heap->free) < req) {
+    size_t incr= gcQuantum;
+    while (incr < req || incr < heap->size / 4) incr *= 2;
+    GC_heap_close(heap);
+    if (!(heap->free= malloc(incr))) {
+      fprintf(stderr, "GC: out of memory\n");
+      abort();
+    }
+    heap->limit= heap->free + incr;
+    heap->size += incr;
+  }
+  hdr= (gcheader *)heap->free;
+  GC_heap_append(heap, hdr, lbs);
+  hdr->used= 1;
+  heap->used += lbs;
+  memset(hdr2ptr(hdr), 0, lbs);
+  return hdr2ptr(hdr);
+}
+
+GC_API void GC_merge_heap(GC_Heap *heap)
+{
+  if (heap->first) {
+    if (gcMemory < heap->used) {
+      fprintf(stderr, "GC: out of memory\n");
+      abort();
+    }
+    GC_heap_close(heap);
+    heap->last->next= gcbase.next;
+    gcbase.next= heap->first;
+    gcMemory -= heap->used;
+    gcHeap += heap->size;
+  }
+  free(heap);
+}
+
 GC_API size_t GC_size(void *ptr)
 {
   return ptr2hdr(ptr)->size;
@@ -321,7 +415,7 @@ static void ***roots= 0;
 static size_t numRoots= 0;
 static size_t maxRoots= 0;
 
-struct GC_StackRoot *GC_stack_roots= 0;
+__thread struct GC_StackRoot *GC_stack_roots= 0;
 
 GC_API void GC_add_root(void *root)
 {
@@ -67,7 +67,15 @@ typedef void (*GC_finaliser_t)(void *ptr, void *data);
 
 GC_API	void GC_register_finaliser(void *ptr, GC_finaliser_t finaliser, void *data);
 
-extern struct GC_StackRoot *GC_stack_roots;
+/* a private heap for a thread to allocate into while no collection can run */
+
+typedef struct GC_Heap GC_Heap;
+
+GC_API	GC_Heap *GC_new_heap(void);
+GC_API	void	 GC_use_heap(GC_Heap *heap);
+GC_API	void	 GC_merge_heap(GC_Heap *heap);
+
+extern __thread struct GC_StackRoot *GC_stack_roots;
 
 #if defined(NDEBUG)
 
@@ -0,0 +1,626 @@
+/* peg-c.h -- runtime support for parsers generated by compile-peg-c.l
+ *
+ * A generated parser recognises UTF-8 text in p->text[0 .. p->limit).  Every
+ * rule function answers 1 and advances p->pos on success, or answers 0 and
+ * leaves p->pos and p->nevents unchanged on failure (undoing any events it
+ * logged with peg_rewind).
+ *
+ * The grammar's semantic actions are not translated.  Instead a rule that
+ * computes a value appends an event (rule, start, end) when it succeeds;
+ * events belonging to alternatives that later fail are discarded, so after
+ * a successful parse p->events lists the matches of value rules in the
+ * order they completed (children before parents).  peg_run_actions then
+ * calls back into the host once per event, passing the values its own
+ * callbacks answered for the matches nested inside it.
+ *
+ * A memo keeps the events of its match as an immutable, reference-counted
+ * peg_events, and replaying it appends to the log a single event that
+ * stands for all of them.  Growing a left-recursive match then costs the
+ * same at each step however long the seed, which would otherwise be copied
+ * in and out of its memo every time.
+ *
+ * The helpers are static inline, so a parser that needs only some of them
+ * compiles without unused-function warnings.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct peg_event  peg_event;
+typedef struct peg_events peg_events;
+typedef struct peg_set    peg_set;
+typedef struct peg_head   peg_head;
+typedef struct peg_memo   peg_memo;
+typedef struct peg_parser peg_parser;
+
+struct peg_event
+{
+  int	       rule;
+  long	       start, end;
+  long	       inner;	/* events for matches nested inside this one */
+  peg_events  *saved;	/* if not 0, stands for these events instead */
+  long	       total;	/* events in the log up to this one, counting saved ones */
+};
+
+struct peg_events	/* saved by a memo */
+{
+  long	       refs;
+  long	       count;	/* events, counting those saved within */
+  long	       size;
+  peg_events  *link;	/* while being freed */
+  peg_event    items[];
+};
+
+struct peg_set		/* of rules */
+{
+  int  *rules;
+  int   size, max;
+};
+
+struct peg_head		/* of a left recursion, as in parser.l */
+{
+  peg_head  *next;	/* in p->heads, while growing */
+  peg_head  *chain;	/* in p->allheads */
+  peg_memo  *memo;
+  long       pos;
+  peg_set    involved, evaluate;
+};
+
+struct peg_memo
+{
+  peg_memo   *next;
+  int         rule, state;
+  long        end;
+  peg_events *events;
+  peg_memo   *caller;	/* the recursive invocation running below this one */
+  peg_head   *head;	/* of the recursion this rule is involved in */
+  int         seed;	/* an involved rule's match is in end and events */
+};
+
+struct peg_parser
+{
+  const unsigned char	 *text;
+  long			  pos, limit, cut, freed;
+  peg_memo		**memos;
+  int			  depth;	/* memoised invocations running */
+  long			  base;		/* where the outermost of them began */
+  peg_event		 *events;
+  long			  nevents, maxevents;
+  peg_memo		 *invocations;	/* recursive invocations running */
+  peg_head		 *heads, *allheads;
+};
+
+enum { PEG_FAILED, PEG_SUCCEEDED, PEG_ACTIVE };
+
+static inline void *peg_alloc(size_t size)
+{
+  void *mem= calloc(1, size);
+  if (!mem) { perror("peg"); exit(1); }
+  return mem;
+}
+
+static inline void peg_init(peg_parser *p, const unsigned char *text, long limit)
+{
+  memset(p, 0, sizeof(*p));
+  p->text=  text;
+  p->limit= limit;
+  p->memos= peg_alloc((limit + 1) * sizeof(peg_memo *));
+}
+
+static inline void peg_events_release(peg_events *s)
+{
+  peg_events *dead= 0;
+  if (s && !--s->refs) {
+    s->link= 0;
+    dead= s;
+  }
+  while ((s= dead)) {			/* iteratively, since a grown seed nests as deep as it grew */
+    long i;
+    dead= s->link;
+    for (i= 0;  i < s->size;  ++i) {
+      peg_events *t= s->items[i].saved;
+      if (t && !--t->refs) {
+	t->link= dead;
+	dead= t;
+      }
+    }
+    free(s);
+  }
+}
+
+static inline void peg_memo_free(peg_memo *m)
+{
+  while (m) {
+    peg_memo *next= m->next;
+    peg_events_release(m->events);
+    free(m);
+    m= next;
+  }
+}
+
+/* Discard the events logged since the first n. */
+
+static inline void peg_rewind(peg_parser *p, long n)
+{
+  while (p->nevents > n) peg_events_release(p->events[--p->nevents].saved);
+}
+
+static inline void peg_release(peg_parser *p)
+{
+  long i;
+  for (i= p->freed;  i <= p->limit;  ++i) peg_memo_free(p->memos[i]);
+  peg_rewind(p, 0);
+  while (p->allheads) {
+    peg_head *h= p->allheads;
+    p->allheads= h->chain;
+    free(h->involved.rules);
+    free(h->evaluate.rules);
+    free(h);
+  }
+  free(p->memos);
+  free(p->events);
+  p->memos= 0;
+  p->events= 0;
+}
+
+/* Decode the UTF-8 sequence at p->pos into *c, answering its length in
+ * bytes or 0 at the end of the text.  A byte that does not begin a
+ * well-formed sequence is taken as a character by itself. */
+
+static inline int peg_utf8(peg_parser *p, int *c)
+{
+  const unsigned char *s= p->text + p->pos;
+  long left= p->limit - p->pos;
+  int  n, i, d;
+  if (left <= 0) return 0;
+  *c= s[0];
+  if      (*c < 0x80)		return 1;
+  else if ((*c & 0xe0) == 0xc0)	{ n= 2;  d= *c & 0x1f; }
+  else if ((*c & 0xf0) == 0xe0)	{ n= 3;  d= *c & 0x0f; }
+  else if ((*c & 0xf8) == 0xf0)	{ n= 4;  d= *c & 0x07; }
+  else				return 1;
+  if (n > left) return 1;
+  for (i= 1;  i < n;  ++i) {
+    if ((s[i] & 0xc0) != 0x80) return 1;
+    d= (d << 6) | (s[i] & 0x3f);
+  }
+  *c= d;
+  return n;
+}
+
+static inline int peg_any(peg_parser *p)
+{
+  int c, n= peg_utf8(p, &c);
+  p->pos += n;
+  return n > 0;
+}
+
+static inline int peg_char(peg_parser *p, int c)
+{
+  if (p->pos < p->limit && p->text[p->pos] == c) { ++p->pos;  return 1; }
+  return 0;
+}
+
+static inline int peg_string(peg_parser *p, const char *s, long len)
+{
+  if (p->pos + len <= p->limit && !memcmp(p->text + p->pos, s, len)) { p->pos += len;  return 1; }
+  return 0;
+}
+
+static inline int peg_peek(peg_parser *p, const unsigned char *bits)
+{
+  if (p->pos < p->limit) {
+    int c= p->text[p->pos];
+    return bits[c >> 3] & (1 << (c & 7));
+  }
+  return 0;
+}
+
+static inline int peg_class(peg_parser *p, const unsigned char *bits)
+{
+  if (peg_peek(p, bits)) { ++p->pos;  return 1; }
+  return 0;
+}
+
+/* As peg_class, for a class that also contains the characters beyond ASCII
+ * listed in ascending order in wide[0 .. nwide). */
+
+static inline int peg_class_wide(peg_parser *p, const unsigned char *bits, const int *wide, int nwide)
+{
+  int c, n= peg_utf8(p, &c), lo= 0, hi= nwide;
+  if (!n) return 0;
+  if (c < 0x80) return peg_class(p, bits);
+  while (lo < hi) {
+    int mid= (lo + hi) / 2;
+    if (wide[mid] < c) lo= mid + 1;  else hi= mid;
+  }
+  if (lo == nwide || wide[lo] != c) return 0;
+  p->pos += n;
+  return 1;
+}
+
+/* Nothing before a cut will be re-read, so its memos can go, except that
+ * a memoised invocation still running holds the memo at its own position
+ * and will update it when it returns.  Invocations nest, so memos from the
+ * outermost one's position onwards are kept until it returns. */
+
+static inline void peg_collect(peg_parser *p)
+{
+  long limit= (p->depth && p->base < p->cut) ? p->base : p->cut;
+  for (;  p->freed < limit;  ++p->freed) {
+    peg_memo_free(p->memos[p->freed]);
+    p->memos[p->freed]= 0;
+  }
+}
+
+static inline int peg_cut(peg_parser *p)
+{
+  if (p->cut < p->pos) {
+    p->cut= p->pos;
+    peg_collect(p);
+  }
+  return 1;
+}
+
+static inline void peg_enter(peg_parser *p, long pos)
+{
+  if (!p->depth++) p->base= pos;
+}
+
+static inline void peg_leave(peg_parser *p)
+{
+  if (!--p->depth && p->freed < p->cut) peg_collect(p);
+}
+
+/* The number of events in the first n of the log, counting saved ones. */
+
+static inline long peg_total(peg_parser *p, long n)
+{
+  return n ? p->events[n - 1].total : 0;
+}
+
+static inline peg_event *peg_event_new(peg_parser *p)
+{
+  peg_event *e;
+  if (p->nevents == p->maxevents) {
+    p->maxevents= p->maxevents ? p->maxevents * 2 : 1024;
+    if (!(p->events= realloc(p->events, p->maxevents * sizeof(peg_event)))) { perror("peg");  exit(1); }
+  }
+  e= p->events + p->nevents++;
+  memset(e, 0, sizeof(*e));
+  return e;
+}
+
+/* Log a match of rule from start to end whose nested events were logged
+ * from first onwards. */
+
+static inline void peg_event_add(peg_parser *p, int rule, long start, long end, long first)
+{
+  long	     total= peg_total(p, p->nevents);
+  peg_event *e=	    peg_event_new(p);
+  e->rule=  rule;
+  e->start= start;
+  e->end=   end;
+  e->inner= total - peg_total(p, first);
+  e->total= total + 1;
+}
+
+static inline peg_memo *peg_memo_find(peg_parser *p, long pos, int rule)
+{
+  peg_memo *m;
+  if (pos < p->cut) { fprintf(stderr, "peg: backtracked past a cut at %ld\n", p->cut);  exit(1); }
+  for (m= p->memos[pos];  m;  m= m->next)
+    if (m->rule == rule) return m;
+  return 0;
+}
+
+static inline peg_memo *peg_memo_add(peg_parser *p, long pos, int rule, int state)
+{
+  peg_memo *m= peg_alloc(sizeof(peg_memo));
+  m->rule=  rule;
+  m->state= state;
+  m->end=   pos;
+  m->next=  p->memos[pos];
+  p->memos[pos]= m;
+  return m;
+}
+
+/* Record the current match (p->pos and the events since first) in m. */
+
+static inline void peg_memo_save(peg_parser *p, peg_memo *m, long first)
+{
+  long size= p->nevents - first, i;
+  m->end= p->pos;
+  peg_events_release(m->events);
+  m->events= 0;
+  if (size) {
+    m->events= peg_alloc(sizeof(peg_events) + size * sizeof(peg_event));
+    m->events->refs=  1;
+    m->events->count= peg_total(p, p->nevents) - peg_total(p, first);
+    m->events->size=  size;
+    memcpy(m->events->items, p->events + first, size * sizeof(peg_event));
+    for (i= 0;  i < size;  ++i)
+      if (m->events->items[i].saved) ++m->events->items[i].saved->refs;
+  }
+}
+
+static inline void peg_memo_replay(peg_parser *p, peg_memo *m)
+{
+  if (m->events) {
+    long       total= peg_total(p, p->nevents);
+    peg_event *e=     peg_event_new(p);
+    e->saved= m->events;
+    e->total= total + m->events->count;
+    ++m->events->refs;
+  }
+  p->pos= m->end;
+}
+
+static inline int peg_invoke_memo(peg_parser *p, int rule, int (*body)(peg_parser *))
+{
+  long      pos= p->pos, first= p->nevents;
+  peg_memo *m=   peg_memo_find(p, pos, rule);
+  int       ok;
+  if (m) {
+    if (PEG_SUCCEEDED != m->state) return 0;
+    peg_memo_replay(p, m);
+    return 1;
+  }
+  m= peg_memo_add(p, pos, rule, PEG_FAILED);
+  peg_enter(p, pos);
+  if ((ok= body(p))) {
+    m->state= PEG_SUCCEEDED;
+    peg_memo_save(p, m, first);
+  }
+  peg_leave(p);
+  return ok;
+}
+
+static inline int peg_set_has(peg_set *s, int rule)
+{
+  int i;
+  for (i= 0;  i < s->size;  ++i)
+    if (s->rules[i] == rule) return 1;
+  return 0;
+}
+
+static inline void peg_set_add(peg_set *s, int rule)
+{
+  if (peg_set_has(s, rule)) return;
+  if (s->size == s->max) {
+    s->max= s->max ? s->max * 2 : 8;
+    if (!(s->rules= realloc(s->rules, s->max * sizeof(int)))) { perror("peg");  exit(1); }
+  }
+  s->rules[s->size++]= rule;
+}
+
+static inline int peg_set_remove(peg_set *s, int rule)
+{
+  int i;
+  for (i= 0;  i < s->size;  ++i)
+    if (s->rules[i] == rule) {
+      s->rules[i]= s->rules[--s->size];
+      return 1;
+    }
+  return 0;
+}
+
+/* Left recursion, as in parser.l (Warth, Douglass and Millstein, "Packrat
+ * parsers can support left recursion").  A recursive rule entered at a
+ * position is pushed onto p->invocations and memoised as PEG_ACTIVE until
+ * it returns; its memo plays the part of parser.l's <peg-lr>.  Re-entering
+ * an active rule fails, makes that rule the head of a recursion and
+ * involves in it every recursive rule invoked since.  When the head
+ * returns with a seed it grows the match, re-evaluating its body until the
+ * match stops getting longer.  While it grows, p->heads records the head
+ * at its position: each involved rule is evaluated afresh there once per
+ * iteration and its memo reused for the rest of the iteration, and rules
+ * not involved and not already memoised there fail.  An involved rule that
+ * is not itself a head keeps its seed in its memo (which stays PEG_ACTIVE)
+ * for the head to grow. */
+
+static inline void peg_involve(peg_parser *p, peg_memo *lr)
+{
+  peg_head *h= lr->head;
+  peg_memo *s, *top;
+  if (!h) {
+    h= lr->head= peg_alloc(sizeof(peg_head));
+    h->memo=  lr;
+    h->chain= p->allheads;
+    p->allheads= h;
+  }
+  for (top= p->invocations;  top && top != h->memo;  top= top->caller);	/* the head may have returned already */
+  for (s= p->invocations;  top && s != top;  s= s->caller) {
+    peg_head *other= s->head;
+    if (other != h) {							/* an inner head gives up its rules to this one */
+      int i;
+      peg_set_add(&h->involved, s->rule);
+      if (other)
+	for (i= 0;  i < other->involved.size;  ++i)
+	  peg_set_add(&h->involved, other->involved.rules[i]);
+      s->head= h;
+    }
+  }
+}
+
+static inline peg_memo *peg_recall(peg_parser *p, long pos, int rule, int (*body)(peg_parser *))
+{
+  static peg_memo failed;	/* PEG_FAILED */
+  peg_memo *m= peg_memo_find(p, pos, rule);
+  peg_head *h;
+  for (h= p->heads;  h && h->pos != pos;  h= h->next);
+  if (!h) return m;
+  if (!m) return peg_set_has(&h->involved, rule) ? 0 : &failed;
+  if (peg_set_remove(&h->evaluate, rule)) {
+    long first= p->nevents;
+    if (body(p)) {
+      m->state= PEG_SUCCEEDED;
+      peg_memo_save(p, m, first);
+    }
+    else
+      m->state= PEG_FAILED;
+    p->pos= pos;
+    peg_rewind(p, first);
+  }
+  return m;
+}
+
+static inline void peg_grow(peg_parser *p, peg_memo *m, long pos, long first, int (*body)(peg_parser *))
+{
+  peg_head *h= m->head;
+  int       i;
+  m->state= PEG_SUCCEEDED;
+  peg_memo_save(p, m, first);
+  h->pos=  pos;
+  h->next= p->heads;
+  p->heads= h;
+  for (;;) {
+    p->pos= pos;						/* rewind to the start of the recursive match */
+    peg_rewind(p, first);
+    h->evaluate.size= 0;
+    for (i= 0;  i < h->involved.size;  ++i) peg_set_add(&h->evaluate, h->involved.rules[i]);
+    if (!body(p) || p->pos <= m->end) break;			/* grow the prefix recursively */
+    peg_memo_save(p, m, first);
+  }
+  p->heads= h->next;
+  peg_rewind(p, first);
+  peg_memo_replay(p, m);
+}
+
+static inline int peg_invoke_recursive(peg_parser *p, int rule, int (*body)(peg_parser *))
+{
+  long      pos= p->pos, first= p->nevents;
+  peg_memo *m=   peg_recall(p, pos, rule, body);
+  int       ok;
+  if (m) {							/* entered here before: succeeded, failed, or involved in a recursion */
+    switch (m->state) {
+      case PEG_SUCCEEDED:	peg_memo_replay(p, m);  return 1;
+      case PEG_ACTIVE:		peg_involve(p, m);
+				if (!m->seed) return 0;
+				peg_memo_replay(p, m);  return 1;
+      default:			return 0;
+    }
+  }
+  m= peg_memo_add(p, pos, rule, PEG_ACTIVE);
+  m->caller= p->invocations;
+  p->invocations= m;
+  peg_enter(p, pos);
+  ok= body(p);
+  p->invocations= m->caller;
+  if (!m->head) {
+    if (ok) {
+      m->state= PEG_SUCCEEDED;
+      peg_memo_save(p, m, first);
+    }
+    else
+      m->state= PEG_FAILED;
+  }
+  else if (m->head->memo != m) {				/* involved: the head will grow it */
+    if ((m->seed= ok)) peg_memo_save(p, m, first);
+  }
+  else if (ok)
+    peg_grow(p, m, pos, first, body);
+  else
+    m->state= PEG_FAILED;
+  peg_leave(p);
+  return ok;
+}
+
+/* Run the host's action for each event of a successful parse, in the order
+ * the matches completed.  The action for a match receives, in values[0 ..
+ * nvalues), what the actions for the matches directly inside it answered.
+ * peg_run_actions answers what the last action called answered: the value
+ * of the outermost match if the start rule computes one. */
+
+typedef void *peg_action(void *ctx, int rule, long start, long end, void **values, long nvalues);
+
+static inline void *peg_run_actions(peg_parser *p, peg_action *action, void *ctx)
+{
+  long	      count=  peg_total(p, p->nevents);
+  void	    **values= peg_alloc((count + 1) * sizeof(void *));	/* of the matches not yet inside another */
+  long	     *owners= peg_alloc((count + 1) * sizeof(long));	/* their places in the order of completion */
+  long	      max=    16, depth= 1, top= 0, i= 0;
+  peg_event **next=   peg_alloc(max * sizeof(peg_event *));	/* the log and the saved events within it being walked */
+  peg_event **last=   peg_alloc(max * sizeof(peg_event *));
+  void	     *result= 0;
+  next[0]= p->events;
+  last[0]= p->events + p->nevents;
+  while (depth) {
+    peg_event *e;
+    long       base= top;
+    if (next[depth - 1] == last[depth - 1]) {
+      --depth;
+      continue;
+    }
+    e= next[depth - 1]++;
+    if (e->saved) {
+      if (depth == max) {
+	max *= 2;
+	if (!(next= realloc(next, max * sizeof(peg_event *))) || !(last= realloc(last, max * sizeof(peg_event *)))) { perror("peg");  exit(1); }
+      }
+      next[depth]= e->saved->items;
+      last[depth]= e->saved->items + e->saved->size;
+      ++depth;
+      continue;
+    }
+    while (base > 0 && owners[base - 1] >= i - e->inner) --base;
+    result= action(ctx, e->rule, e->start, e->end, values + base, top - base);
+    values[base]= result;
+    owners[base]= i++;
+    top= base + 1;
+  }
+  free(values);
+  free(owners);
+  free(next);
+  free(last);
+  return result;
+}
+
+static int peg_parse(peg_parser *p);
+
+extern const char *peg_rule_names[];
+
+#if defined(PEG_MAIN)
+
+/* ./parser [-v] file ...  parses each file with the start rule and reports
+ * how much of it matched; -v also lists the events, with the number of
+ * matches directly inside each.  As with parse-file, the start rule need
+ * not consume all of the input. */
+
+static void *peg_print_event(void *ctx, int rule, long start, long end, void **values, long nvalues)
+{
+  printf("%s %ld %ld %ld\n", peg_rule_names[rule], start, end, nvalues);
+  return ctx;
+}
+
+int main(int argc, char **argv)
+{
+  int verbose= 0, status= 0, i;
+  for (i= 1;  i < argc;  ++i) {
+    FILE	  *in;
+    unsigned char *text;
+    long	   size;
+    peg_parser	   p;
+    if (!strcmp(argv[i], "-v")) { verbose= 1;  continue; }
+    if (!(in= fopen(argv[i], "rb"))) { perror(argv[i]);  return 1; }
+    fseek(in, 0, SEEK_END);
+    size= ftell(in);
+    fseek(in, 0, SEEK_SET);
+    text= peg_alloc(size + 1);
+    if (size != (long)fread(text, 1, size, in)) { perror(argv[i]);  return 1; }
+    fclose(in);
+    peg_init(&p, text, size);
+    if (!peg_parse(&p)) status= 1;
+    printf("%s: matched %ld of %ld bytes\n", argv[i], p.pos, size);
+    if (verbose) {
+      printf("%ld events\n", peg_total(&p, p.nevents));
+      peg_run_actions(&p, peg_print_event, &p);
+    }
+    peg_release(&p);
+    free(text);
+  }
+  return status;
+}
+
+#endif
@@ -27,6 +27,7 @@ rparen     	= ")"  space ;
 lbrace      	= "{"  space ;
 rbrace     	= "}"  space ;
 dot       	= "."  space ;
+caret       	= "^"  space ;
 digit		= [0-9] ;
 higit		= [0-9A-Fa-f] ;
 number		= ("-"? digit+) @$#:n space -> n ;
@@ -88,6 +89,7 @@ atom		= lparen expression:e rparen			-> e
 		| identifier:e					-> `(match-rule ,e)
 		| lbrace sexpression*:e space rbrace		-> `(match-rule ,@e)
 		| dot						-> `(match-any)
+		| caret						-> `(match-cut)
 		| arrow sexpression:e space			-> `(result-expr ,e)
 		| backquote llist:e				-> `(match-list ,e)
 		;
@@ -217,10 +219,11 @@ value =
  					         (set self.result (parser-stream-next self.source)))
  | 'match-any				-> '(and (!= *end* (parser-stream-peek self.source))
 					      (let () (set self.result (parser-stream-next self.source)) 1))
+ | 'match-cut				-> '(parser-stream-cut self.source)
  | 'make-span effect:exp		-> `(let ((pos (<parser-stream>-position self.source)))
  					      (and ,exp
  					           (let ()
- 						     (set self.result (list-from-to pos (<parser-stream>-position self.source)))
+ 						     (set self.result (parser-stream-list-from-to self.source pos (<parser-stream>-position self.source)))
  						     1)))
  | 'make-string value:exp		-> `(and ,exp (set self.result (list->string self.result)))
  | 'make-symbol value:exp		-> `(and ,exp (set self.result (string->symbol (list->string self.result))))
@@ -266,6 +269,7 @@ effect =
  | 'match-string  .:str			-> `(parser-stream-match-string self.source ,str)
  | 'match-object  .:obj			-> `(parser-stream-match-object self.source ',obj)
  | 'match-any				-> '(parser-stream-match-any    self.source)
+ | 'match-cut				-> '(parser-stream-cut          self.source)
  | 'make-span     effect:exp		->  exp
  | 'make-string   effect:exp		->  exp
  | 'make-symbol   effect:exp		->  exp
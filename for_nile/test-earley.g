@@ -0,0 +1,4 @@
+<expr> : <parser> ()
+digit		= [0-9] ;
+product		= digit ("*" digit)* ;
+sum		= product ("+" product)* ;
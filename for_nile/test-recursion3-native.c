@@ -0,0 +1,128 @@
+/* test-recursion3-native.c -- test-recursion3.l for the native parser
+ *
+ * make test-recursion3-native
+ *
+ * Parse left-recursive expressions with the parser that compile-peg-c.l
+ * generates from test-recursion3.g, with sum and product each recursive
+ * and call and member recursive through each other, running the grammar's
+ * actions (written again here in C) through peg_run_actions.  The values
+ * should be those that test-recursion3.l prints, and the time per
+ * character should stay roughly constant as the input grows.
+ */
+
+#include "recursion3-native.c"
+
+#include <time.h>
+
+typedef struct value value;
+
+struct value
+{
+  value  *next;		/* allocated before this one */
+  long	  end;		/* of the match */
+  long	  number;	/* of a sum */
+  char	 *form;		/* of a member chain */
+};
+
+static value *values= 0;
+
+static value *value_new(long end, long number, char *form)
+{
+  value *v= peg_alloc(sizeof(value));
+  v->next=   values;
+  v->end=    end;
+  v->number= number;
+  v->form=   form;
+  return values= v;
+}
+
+static void values_free(void)
+{
+  while (values) {
+    value *v= values;
+    values= v->next;
+    free(v->form);
+    free(v);
+  }
+}
+
+static char *form_new(const char *op, const char *arg)
+{
+  char *form= peg_alloc(strlen(op) + strlen(arg) + 4);
+  sprintf(form, "(%s %s)", op, arg);
+  return form;
+}
+
+/* The actions of test-recursion3.g.  The operator of a binary match
+ * follows the match of its left operand. */
+
+static void *action(void *ctx, int rule, long start, long end, void **args, long nargs)
+{
+  peg_parser *p= ctx;
+  value	    **v= (value **)args;
+  switch (rule) {
+    case R_digit:	return value_new(end, p->text[start] - '0', 0);
+    case R_product:	if (2 == nargs) return value_new(end, v[0]->number * v[1]->number % 1000, 0);
+			break;
+    case R_sum:		if (2 == nargs && '+' == p->text[v[0]->end]) return value_new(end, (v[0]->number + v[1]->number) % 1000, 0);
+			if (2 == nargs)				     return value_new(end, (1000 + v[0]->number - v[1]->number) % 1000, 0);
+			break;
+    case R_call:	return value_new(end, 0, nargs ? form_new("call", v[0]->form) : strdup("f"));
+    case R_member:	if (end > v[0]->end) return value_new(end, 0, form_new("get", v[0]->form));
+			break;
+  }
+  return value_new(end, v[0]->number, v[0]->form ? strdup(v[0]->form) : 0);
+}
+
+static value *parse(peg_parser *p, int (*rule)(peg_parser *), const char *text)
+{
+  long size= strlen(text);
+  peg_init(p, (const unsigned char *)text, size);
+  if (!rule(p) || size != p->pos) {
+    fprintf(stderr, "parsed %ld of %ld characters\n", p->pos, size);
+    exit(1);
+  }
+  return peg_run_actions(p, action, p);
+}
+
+int main(void)
+{
+  static struct { const char *text;  long value; } sums[]= {
+    { "1+2*3", 7 }, { "1*2+3", 5 }, { "(1+2)*3-4", 5 }, { "9-2-3", 4 }, { "2*(3+4)*5", 70 }
+  };
+  static const char *chains[]= { "f()", "f.x", "f().x()", "f.x().x" };
+  peg_parser p;
+  long	     size, i, j;
+
+  for (i= 0;  i < (long)(sizeof(sums) / sizeof(*sums));  ++i) {
+    value *v= parse(&p, r_expr, sums[i].text);
+    printf("%s = %ld\n", sums[i].text, v->number);
+    if (v->number != sums[i].value) {
+      fprintf(stderr, "expected %ld\n", sums[i].value);
+      return 1;
+    }
+    peg_release(&p);
+    values_free();
+  }
+  for (i= 0;  i < (long)(sizeof(chains) / sizeof(*chains));  ++i) {
+    printf("%s => %s\n", chains[i], parse(&p, r_chain, chains[i])->form);
+    peg_release(&p);
+    values_free();
+  }
+  for (size= 100000;  size <= 800000;  size *= 2) {
+    char   *text= peg_alloc(size + 2);
+    clock_t start;
+    text[0]= '1';
+    for (j= 0;  j < size / 2;  ++j) {
+      text[2 * j + 1]= (j & 1) ? '+' : '*';
+      text[2 * j + 2]= '0' + j % 10;
+    }
+    start= clock();
+    parse(&p, peg_parse, text);
+    printf("; %ld characters in %ld ms\n", (long)strlen(text), (long)((clock() - start) * 1000 / CLOCKS_PER_SEC));
+    peg_release(&p);
+    values_free();
+    free(text);
+  }
+  return 0;
+}
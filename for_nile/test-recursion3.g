@@ -0,0 +1,27 @@
+<r3> : <parser> ()
+
+digit   = [0-9]:d			-> (- d ?0) ;
+
+primary = digit
+        | "(" sum:s ")"			-> s
+        ;
+
+product = product:a "*" primary:b	-> (% (* a b) 1000)
+        | primary
+        ;
+
+sum     = sum:a "+" product:b		-> (% (+ a b) 1000)
+        | sum:a "-" product:b		-> (% (+ 1000 (- a b)) 1000)
+        | product
+        ;
+
+call    = member:m "()"			-> `(call ,m)
+        | "f"				-> 'f
+        ;
+
+member  = call:c "." "x"		-> `(get ,c)
+        | call:c			-> c
+        ;
+
+expr    = sum:s				-> s ;
+chain   = member:m			-> m ;
@@ -29,6 +29,7 @@ rparen     	= ")"  space ;
 lbrace      	= "{"  space ;
 rbrace     	= "}"  space ;
 dot       	= "."  space ;
+caret       	= "^"  space ;
 tilde       	= "~"  space ;
 digit		= [0-9] ;
 higit		= [0-9A-Fa-f] ;
@@ -87,6 +88,7 @@ atom		= lparen expression:e rparen			-> e
 		| identifier:e					-> `(match-rule ,e)
 		| lbrace sexpression*:e space rbrace		-> `(match-rule ,@e)
 		| dot						-> `(match-any)
+		| caret						-> `(match-cut)
 		| arrow sexpression:e space			-> `(result-expr ,e)
 		| backquote llist:e				-> `(match-list ,e)
 		;